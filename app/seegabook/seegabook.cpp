@@ -0,0 +1,76 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+
+#include "argparser.h"
+
+#include "bitboard.h"
+#include "gamerecord.h"
+#include "openingbook.h"
+
+namespace arg = argparser;
+
+struct options_t
+{
+	std::string records;
+	int board_size;
+	int max_plies;
+	unsigned int min_games;
+	std::string path;
+};
+
+int main(int argc, char** argv)
+{
+	options_t options;
+
+	arg::build_parser(argc, argv, options,
+		"Seega livro de aberturas\n"
+		"========================\n"
+		"Junta as colocacoes de pecas das partidas gravadas pelo seegasim\n"
+		"e o resultado de cada uma, para o robo colocar as pecas sem\n"
+		"pensar nas posicoes conhecidas.")
+
+		.bind("partidas", &options_t::records,
+			arg::doc("Arquivo gerado pelo seegasim com as partidas"),
+			arg::def("partidas.sgr"))
+
+		.bind("tamanho", &options_t::board_size,
+			arg::doc("Tamanho do tabuleiro, ate " + std::to_string(BitBoard::MAX_DIM) +
+				" (as partidas de outros tamanhos sao ignoradas)"),
+			arg::def(5))
+
+		.bind("jogadas", &options_t::max_plies,
+			arg::doc("Numero de colocacoes guardadas desde o inicio da partida"),
+			arg::def(48))
+
+		.bind("min-partidas", &options_t::min_games,
+			arg::doc("Vezes que uma colocacao precisa ter sido jogada para entrar no livro"),
+			arg::def(OpeningBook::DEFAULT_MIN_GAMES))
+
+		.bind("arquivo", &options_t::path,
+			arg::doc("Arquivo de saida"),
+			arg::def("seega5.book"))
+
+		.build();
+
+	if (options.board_size < 2 || options.board_size > BitBoard::MAX_DIM) {
+		std::cerr << "The board size must be between 2 and " << BitBoard::MAX_DIM << "\n";
+		return 1;
+	}
+
+	RecordReader records;
+	if (!records.open(options.records)) {
+		std::cerr << "Could not open the games '" << options.records << "'\n";
+		return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	if (!OpeningBook::build(records, options.board_size, options.max_plies,
+		options.min_games, options.path, std::cout)) {
+		std::cerr << "Could not build the book into '" << options.path << "'\n";
+		return 1;
+	}
+	auto end = std::chrono::steady_clock::now();
+	std::cout << "written to " << options.path << " in "
+	          << std::chrono::duration<double>(end - start).count() << " s\n";
+}
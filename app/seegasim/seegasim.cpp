@@ -0,0 +1,209 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+
+#include "argparser.h"
+
+#include "bitboard.h"
+#include "selfplay.h"
+#include "workstealing.h"
+
+namespace arg = argparser;
+
+struct options_t
+{
+	int board_size;
+	unsigned int seed;
+	unsigned long long games;
+	int max_plies;
+	unsigned int threads;
+	std::string ai_type;
+	std::string ai_yellow;
+	std::string ai_red;
+	unsigned long ai_time;
+	int ai_depth;
+	unsigned long ai_hash;
+	bool ai_symmetry;
+	unsigned long long ai_playouts;
+	unsigned int ai_threads;
+	std::string tablebase;
+	std::string book;
+	std::string record;
+};
+
+int main(int argc, char** argv)
+{
+	options_t options;
+
+	arg::build_parser(argc, argv, options,
+		"Seega headless\n"
+		"==============\n"
+		"Joga partidas robo contra robo em sequencia e mede a vazao.")
+
+		.bind("tamanho", &options_t::board_size,
+			arg::doc("Tamanho do tabuleiro (acima de " + std::to_string(BitBoard::MAX_DIM) +
+				", so o robo aleatorio joga)"),
+			arg::def(5))
+
+		.bind("semente", &options_t::seed,
+			arg::doc("Semente do gerador de numeros aleatorios"),
+			arg::def(0))
+
+		.bind("partidas", &options_t::games,
+			arg::doc("Numero de partidas"),
+			arg::def(1000))
+
+		.bind("max-jogadas", &options_t::max_plies,
+			arg::doc("Jogadas ate a partida ser declarada empate"),
+			arg::def(1000))
+
+		.bind("threads", &options_t::threads,
+			arg::doc("Numero de threads (0 = uma por nucleo)"),
+			arg::def(1))
+
+		.bind("ia-tipo", &options_t::ai_type,
+			arg::doc("Estrategia dos dois robos (" + AgentRegistry::instance().listNames() + ")"),
+			arg::def("aleatorio"))
+
+		.bind("ia-amarelo", &options_t::ai_yellow,
+			arg::doc("Estrategia do robo amarelo (vazio = a de --ia-tipo)"),
+			arg::def(""))
+
+		.bind("ia-vermelho", &options_t::ai_red,
+			arg::doc("Estrategia do robo vermelho (vazio = a de --ia-tipo)"),
+			arg::def(""))
+
+		.bind("ia-tempo", &options_t::ai_time,
+			arg::doc("Tempo maximo da busca por jogada em milisegundos (0 = sem limite)"),
+			arg::def(0))
+
+		.bind("ia-profundidade", &options_t::ai_depth,
+			arg::doc("Profundidade maxima da busca"),
+			arg::def(4))
+
+		.bind("ia-hash", &options_t::ai_hash,
+			arg::doc("Tamanho da tabela de transposicao em MB (0 = sem tabela)"),
+			arg::def(4))
+
+		.bind("ia-simetria", &options_t::ai_symmetry,
+			arg::doc("Tabela de transposicao junta rotacoes e reflexoes da posicao (0 = nao)"),
+			arg::def(false))
+
+		.bind("ia-simulacoes", &options_t::ai_playouts,
+			arg::doc("Simulacoes do mcts por jogada (0 = limitado so pelo tempo)"),
+			arg::def(1000))
+
+		.bind("ia-threads", &options_t::ai_threads,
+			arg::doc("Threads da busca do robo, alfabeta ou mcts (0 = uma por nucleo)"),
+			arg::def(1))
+
+		.bind("tabela-finais", &options_t::tablebase,
+			arg::doc("Arquivo gerado pelo seegatb com as tabelas de finais (vazio = sem tabelas)"),
+			arg::def(""))
+
+		.bind("livro", &options_t::book,
+			arg::doc("Arquivo gerado pelo seegabook com as aberturas (vazio = sem livro)"),
+			arg::def(""))
+
+		.bind("gravar", &options_t::record,
+			arg::doc("Arquivo onde gravar as partidas em formato binario (vazio = nao gravar)"),
+			arg::def(""))
+
+		.build();
+
+	if (options.board_size < 2) {
+		std::cerr << "The board size must be at least 2\n";
+		return 1;
+	}
+
+	SelfPlayOptions sim;
+	sim.agents[0] = options.ai_yellow.empty() ? options.ai_type : options.ai_yellow;
+	sim.agents[1] = options.ai_red.empty() ? options.ai_type : options.ai_red;
+	for (std::string const& agent : sim.agents)
+		if (!AgentRegistry::instance().contains(agent)) {
+			std::cerr << "Unknown AI type '" << agent << "' (known: "
+			          << AgentRegistry::instance().listNames() << ")\n";
+			return 1;
+		}
+	if (options.ai_time == 0 && options.ai_playouts == 0 &&
+		(sim.agents[0] == "mcts" || sim.agents[1] == "mcts")) {
+		std::cerr << "The mcts needs --ia-tempo or --ia-simulacoes above 0\n";
+		return 1;
+	}
+	sim.board_size = options.board_size;
+	sim.seed = options.seed;
+	sim.games = options.games;
+	sim.max_plies = options.max_plies;
+	sim.threads = options.threads;
+	sim.agent.search.time_ms = options.ai_time;
+	sim.agent.search.max_depth = options.ai_depth;
+	sim.agent.search.hash_mb = options.ai_hash;
+	sim.agent.search.symmetry = options.ai_symmetry;
+	sim.agent.search.threads = options.ai_threads;
+	sim.agent.mcts.time_ms = options.ai_time;
+	sim.agent.mcts.max_playouts = options.ai_playouts;
+	sim.agent.mcts.threads = options.ai_threads;
+
+	if (!options.tablebase.empty()) {
+		auto tablebase = std::make_shared<Tablebase>();
+		if (!tablebase->open(options.tablebase)) {
+			std::cerr << "Could not open the tables '" << options.tablebase << "'\n";
+			return 1;
+		}
+		sim.agent.tablebase = tablebase;
+	}
+	if (!options.book.empty()) {
+		auto book = std::make_shared<OpeningBook>();
+		if (!book->open(options.book)) {
+			std::cerr << "Could not open the book '" << options.book << "'\n";
+			return 1;
+		}
+		sim.book = book;
+	}
+	if (!options.record.empty()) {
+		if (options.board_size > BitBoard::MAX_DIM) {
+			std::cerr << "Games can only be recorded on boards up to " <<
+				BitBoard::MAX_DIM << "\n";
+			return 1;
+		}
+		sim.record = std::make_shared<RecordWriter>();
+		if (!sim.record->open(options.record)) {
+			std::cerr << "Could not create the record '" << options.record << "'\n";
+			return 1;
+		}
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	SelfPlayStats stats = runSelfPlay(sim);
+	auto end = std::chrono::steady_clock::now();
+	if (sim.record && !sim.record->close()) {
+		std::cerr << "Could not write the record '" << options.record << "'\n";
+		return 1;
+	}
+
+	const double seconds = std::chrono::duration<double>(end - start).count();
+	const double games = stats.games ? (double) stats.games : 1.;
+	std::cout << "games:        " << stats.games << '\n'
+	          << "threads:      " << WorkStealingRunner(sim.threads).getThreadCount() << '\n'
+	          << "seconds:      " << seconds << '\n'
+	          << "games/second: " << stats.games / seconds << '\n'
+	          << "avg plies:    " << stats.plies / games << '\n'
+	          << "yellow wins:  " << stats.yellow_wins << '\n'
+	          << "red wins:     " << stats.red_wins << '\n'
+	          << "draws:        " << stats.draws << '\n';
+	if (sim.record)
+		std::cout << "recorded:     " << sim.record->getGameCount() << '\n';
+	if (stats.search.nodes > 0) {
+		SearchStats const& search = stats.search;
+		const double probes = search.tt_probes ? (double) search.tt_probes : 1.;
+		std::cout << "nodes:        " << search.nodes << '\n'
+		          << "nodes/second: " << search.nodes / seconds << '\n'
+		          << "tt probes:    " << search.tt_probes << '\n'
+		          << "tt hits:      " << search.tt_hits
+		          << " (" << 100. * search.tt_hits / probes << "%)\n"
+		          << "tt collisions:" << search.tt_collisions
+		          << " (" << 100. * search.tt_collisions / probes << "%)\n";
+		if (sim.agent.tablebase)
+			std::cout << "tb hits:      " << search.tb_hits << '\n';
+	}
+}
@@ -0,0 +1,51 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+
+#include "argparser.h"
+
+#include "tablebase.h"
+
+namespace arg = argparser;
+
+struct options_t
+{
+	int board_size;
+	int max_pieces;
+	std::string path;
+};
+
+int main(int argc, char** argv)
+{
+	options_t options;
+
+	arg::build_parser(argc, argv, options,
+		"Seega tabela de finais\n"
+		"======================\n"
+		"Gera por analise retrograda o valor exato (vitoria, derrota ou\n"
+		"empate e a distancia ate o fim) de cada posicao da fase de\n"
+		"movimentacao com poucas pecas no tabuleiro.")
+
+		.bind("tamanho", &options_t::board_size,
+			arg::doc("Tamanho do tabuleiro"),
+			arg::def(5))
+
+		.bind("pecas", &options_t::max_pieces,
+			arg::doc("Numero maximo de pecas no tabuleiro, somando as duas cores"),
+			arg::def(5))
+
+		.bind("arquivo", &options_t::path,
+			arg::doc("Arquivo de saida"),
+			arg::def("seega5.tb"))
+
+		.build();
+
+	auto start = std::chrono::steady_clock::now();
+	if (!Tablebase::build(options.board_size, options.max_pieces, options.path, std::cout)) {
+		std::cerr << "Could not build the tables into '" << options.path << "'\n";
+		return 1;
+	}
+	auto end = std::chrono::steady_clock::now();
+	std::cout << "written to " << options.path << " in "
+	          << std::chrono::duration<double>(end - start).count() << " s\n";
+}
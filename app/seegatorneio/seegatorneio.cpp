@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <chrono>
+
+#include "argparser.h"
+
+#include "bitboard.h"
+#include "tournament.h"
+#include "workstealing.h"
+
+namespace arg = argparser;
+
+struct options_t
+{
+	std::string agents;
+	int board_size;
+	unsigned int seed;
+	unsigned long long pairs;
+	int max_plies;
+	unsigned int threads;
+	unsigned long ai_time;
+	int ai_depth;
+	unsigned long ai_hash;
+	unsigned long long ai_playouts;
+	unsigned int ai_threads;
+	std::string tablebase;
+	std::string book;
+	bool sprt;
+	double sprt_elo0;
+	double sprt_elo1;
+	double sprt_alpha;
+	double sprt_beta;
+};
+
+namespace
+{
+	// "+12.3 [-4.5, +29.0]"
+	std::string formatElo(MatchScore const& score)
+	{
+		double low, high;
+		score.getEloInterval(low, high);
+		std::ostringstream out;
+		out << std::showpos << std::fixed << std::setprecision(1)
+		    << score.getElo() << " [" << low << ", " << high << ']';
+		return out.str();
+	}
+
+	void printScore(std::string const& name, MatchScore const& score)
+	{
+		std::cout << std::left << std::setw(24) << name << std::right
+		          << std::setw(7) << score.wins << std::setw(7) << score.draws
+		          << std::setw(7) << score.losses << std::setw(8)
+		          << std::fixed << std::setprecision(3) << score.getScore()
+		          << "  " << formatElo(score) << '\n';
+	}
+}
+
+int main(int argc, char** argv)
+{
+	options_t options;
+
+	arg::build_parser(argc, argv, options,
+		"Seega torneio\n"
+		"=============\n"
+		"Todos os robos jogam contra todos e estima a diferenca de Elo entre eles.")
+
+		.bind("robos", &options_t::agents,
+			arg::doc("Estrategias separadas por virgula (" + AgentRegistry::instance().listNames() + ")"),
+			arg::def("alfabeta,aleatorio"))
+
+		.bind("tamanho", &options_t::board_size,
+			arg::doc("Tamanho do tabuleiro (acima de " + std::to_string(BitBoard::MAX_DIM) +
+				", so o robo aleatorio joga)"),
+			arg::def(5))
+
+		.bind("semente", &options_t::seed,
+			arg::doc("Semente do gerador de numeros aleatorios"),
+			arg::def(0))
+
+		.bind("pares", &options_t::pairs,
+			arg::doc("Pares de partidas, uma com cada cor, entre cada dois robos"),
+			arg::def(100))
+
+		.bind("max-jogadas", &options_t::max_plies,
+			arg::doc("Jogadas ate a partida ser declarada empate"),
+			arg::def(1000))
+
+		.bind("threads", &options_t::threads,
+			arg::doc("Numero de threads (0 = uma por nucleo)"),
+			arg::def(1))
+
+		.bind("ia-tempo", &options_t::ai_time,
+			arg::doc("Tempo maximo da busca por jogada em milisegundos (0 = sem limite)"),
+			arg::def(0))
+
+		.bind("ia-profundidade", &options_t::ai_depth,
+			arg::doc("Profundidade maxima da busca"),
+			arg::def(4))
+
+		.bind("ia-hash", &options_t::ai_hash,
+			arg::doc("Tamanho da tabela de transposicao em MB (0 = sem tabela)"),
+			arg::def(4))
+
+		.bind("ia-simulacoes", &options_t::ai_playouts,
+			arg::doc("Simulacoes do mcts por jogada (0 = limitado so pelo tempo)"),
+			arg::def(1000))
+
+		.bind("ia-threads", &options_t::ai_threads,
+			arg::doc("Threads da busca de cada robo, alfabeta ou mcts (0 = uma por nucleo)"),
+			arg::def(1))
+
+		.bind("tabela-finais", &options_t::tablebase,
+			arg::doc("Arquivo gerado pelo seegatb com as tabelas de finais (vazio = sem tabelas)"),
+			arg::def(""))
+
+		.bind("livro", &options_t::book,
+			arg::doc("Arquivo gerado pelo seegabook com as aberturas (vazio = sem livro)"),
+			arg::def(""))
+
+		.bind("sprt", &options_t::sprt,
+			arg::doc("Para o duelo de dois robos assim que o SPRT decidir (0 = nao)"),
+			arg::def(false))
+
+		.bind("sprt-elo0", &options_t::sprt_elo0,
+			arg::doc("Vantagem de Elo do primeiro robo sob a hipotese nula"),
+			arg::def(0.))
+
+		.bind("sprt-elo1", &options_t::sprt_elo1,
+			arg::doc("Vantagem de Elo do primeiro robo sob a hipotese alternativa"),
+			arg::def(10.))
+
+		.bind("sprt-alfa", &options_t::sprt_alpha,
+			arg::doc("Chance de aceitar a hipotese alternativa sendo falsa"),
+			arg::def(0.05))
+
+		.bind("sprt-beta", &options_t::sprt_beta,
+			arg::doc("Chance de aceitar a hipotese nula sendo falsa"),
+			arg::def(0.05))
+
+		.build();
+
+	TournamentOptions tournament;
+	std::istringstream names(options.agents);
+	for (std::string name; std::getline(names, name, ',');) {
+		if (!AgentRegistry::instance().contains(name)) {
+			std::cerr << "Unknown AI type '" << name << "' (known: "
+			          << AgentRegistry::instance().listNames() << ")\n";
+			return 1;
+		}
+		tournament.agents.push_back(name);
+	}
+	if (tournament.agents.size() < 2) {
+		std::cerr << "A tournament needs at least two AI types\n";
+		return 1;
+	}
+	if (options.sprt && tournament.agents.size() != 2) {
+		std::cerr << "SPRT needs exactly two AI types\n";
+		return 1;
+	}
+	if (options.board_size < 2) {
+		std::cerr << "The board size must be at least 2\n";
+		return 1;
+	}
+	if (options.ai_time == 0 && options.ai_playouts == 0 &&
+		std::find(tournament.agents.begin(), tournament.agents.end(), "mcts") !=
+			tournament.agents.end()) {
+		std::cerr << "The mcts needs --ia-tempo or --ia-simulacoes above 0\n";
+		return 1;
+	}
+	tournament.board_size = options.board_size;
+	tournament.seed = options.seed;
+	tournament.pairs = options.pairs;
+	tournament.max_plies = options.max_plies;
+	tournament.threads = options.threads;
+	tournament.agent.search.time_ms = options.ai_time;
+	tournament.agent.search.max_depth = options.ai_depth;
+	tournament.agent.search.hash_mb = options.ai_hash;
+	tournament.agent.search.threads = options.ai_threads;
+	tournament.agent.mcts.time_ms = options.ai_time;
+	tournament.agent.mcts.max_playouts = options.ai_playouts;
+	tournament.agent.mcts.threads = options.ai_threads;
+	tournament.sprt.enabled = options.sprt;
+	tournament.sprt.elo0 = options.sprt_elo0;
+	tournament.sprt.elo1 = options.sprt_elo1;
+	tournament.sprt.alpha = options.sprt_alpha;
+	tournament.sprt.beta = options.sprt_beta;
+
+	if (!options.tablebase.empty()) {
+		auto tablebase = std::make_shared<Tablebase>();
+		if (!tablebase->open(options.tablebase)) {
+			std::cerr << "Could not open the tables '" << options.tablebase << "'\n";
+			return 1;
+		}
+		tournament.agent.tablebase = tablebase;
+	}
+	if (!options.book.empty()) {
+		auto book = std::make_shared<OpeningBook>();
+		if (!book->open(options.book)) {
+			std::cerr << "Could not open the book '" << options.book << "'\n";
+			return 1;
+		}
+		tournament.book = book;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	TournamentResult result = runTournament(tournament);
+	auto end = std::chrono::steady_clock::now();
+
+	std::cout << std::left << std::setw(24) << "pairing" << std::right
+	          << std::setw(7) << "wins" << std::setw(7) << "draws"
+	          << std::setw(7) << "losses" << std::setw(8) << "score"
+	          << "  elo [95%]\n";
+	for (std::size_t a = 0; a < result.agents.size(); ++a)
+		for (std::size_t b = a + 1; b < result.agents.size(); ++b)
+			printScore(result.agents[a] + " x " + result.agents[b],
+				result.scores[a][b]);
+	if (result.agents.size() > 2) {
+		std::cout << '\n';
+		for (std::size_t a = 0; a < result.agents.size(); ++a)
+			printScore(result.agents[a] + " x todos", result.getTotal(a));
+	}
+
+	const double seconds = std::chrono::duration<double>(end - start).count();
+	std::cout << '\n'
+	          << "pairs:        " << result.pairs << '\n'
+	          << "threads:      " << WorkStealingRunner(tournament.threads).getThreadCount() << '\n'
+	          << "seconds:      " << std::defaultfloat << seconds << '\n';
+	if (tournament.sprt.enabled) {
+		const char* outcome = result.sprt == SprtResult::H1 ? "H1 (elo1 at least)"
+			: result.sprt == SprtResult::H0 ? "H0 (elo0 at most)" : "undecided";
+		std::cout << "sprt:         " << outcome << '\n'
+		          << "llr:          " << result.llr << '\n';
+	}
+}
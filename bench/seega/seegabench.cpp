@@ -0,0 +1,352 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "game.h"
+#include "alphabeta.h"
+#include "board.h"
+#include "evaluator.h"
+
+// Every allocation of the process goes through here, so that each
+// benchmark can report how many it makes per operation
+namespace
+{
+	std::atomic<unsigned long long> allocations(0);
+}
+
+void* operator new(std::size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+// GCC inlines these where it still sees the pointer coming from
+// operator new, not knowing that ours allocates with malloc, and warns
+// of a new/free mismatch that is not there
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+namespace
+{
+	constexpr int POOL_SIZE = 64;
+	constexpr int MAX_PLIES = 1000;
+
+	// Counts the allocations made while the benchmark loop runs
+	class AllocationCounter
+	{
+	public:
+		explicit AllocationCounter(benchmark::State& state) :
+			m_state(state),
+			m_start(allocations.load(std::memory_order_relaxed))
+		{
+		}
+
+		~AllocationCounter()
+		{
+			const unsigned long long count =
+				allocations.load(std::memory_order_relaxed) - m_start;
+			m_state.counters["allocs/op"] = benchmark::Counter(
+				(double) count, benchmark::Counter::kAvgIterations);
+		}
+	private:
+		benchmark::State& m_state;
+		unsigned long long m_start;
+	};
+
+	// Random play from the seed until the movement stage, then the given
+	// number of plies more; nullptr if the game ends before that
+	std::unique_ptr<Game> playTo(int dim, unsigned int seed, Game::Stage stage,
+		int plies)
+	{
+		std::default_random_engine rng(seed);
+		auto game = std::make_unique<Game>(dim, true, rng);
+		game->setVerbose(false);
+		while (game->getStage() != stage)
+			if (!game->autoPlay())
+				return nullptr;
+		for (int p = 0; p < plies; ++p)
+			if (!game->autoPlay() || game->isOver())
+				return nullptr;
+		return game;
+	}
+
+	// One position ("fixed") or a pool of them cycled through ("random"),
+	// all satisfying the filter
+	template<class Filter>
+	std::vector<std::unique_ptr<Game>> positions(int dim, bool random,
+		Game::Stage stage, Filter filter)
+	{
+		std::vector<std::unique_ptr<Game>> pool;
+		const int wanted = random ? POOL_SIZE : 1;
+		for (unsigned int seed = 0; (int) pool.size() < wanted; ++seed) {
+			const int plies = stage == Game::Stage::PLAYING
+				? (random ? (int) (seed * 7 % 40) : 10)
+				: (random ? (int) (seed % (dim * dim / 2)) : dim);
+			auto game = playTo(dim, seed, stage, plies);
+			if (game && filter(*game))
+				pool.push_back(std::move(game));
+		}
+		return pool;
+	}
+
+	std::vector<std::unique_ptr<Game>> positions(int dim, bool random,
+		Game::Stage stage)
+	{
+		return positions(dim, random, stage, [](Game const&) { return true; });
+	}
+
+	bool hasCapture(Game const& game)
+	{
+		return game.getBits().captureTargets(game.getTurn()).any();
+	}
+
+	// Legal move of the player to move that captures
+	Move captureMove(Game const& game)
+	{
+		Move moves[Game::MAX_MOVES];
+		const int count = game.getLegalMoves(moves);
+		const BitMask targets = game.getBits().captureTargets(game.getTurn());
+		for (int i = 0; i < count; ++i)
+			if (targets.test(moves[i].to))
+				return moves[i];
+		return moves[0];
+	}
+}
+
+static void BM_HasPossibleMove(benchmark::State& state)
+{
+	const auto pool = positions((int) state.range(0), state.range(1) != 0,
+		Game::Stage::PLAYING);
+	std::size_t k = 0;
+	AllocationCounter counter(state);
+	for (auto _ : state) {
+		Game const& game = *pool[k];
+		benchmark::DoNotOptimize(game.hasPossibleMove(game.getTurn()));
+		k = k + 1 == pool.size() ? 0 : k + 1;
+	}
+}
+
+// Move list built the way Game::chooseMove builds it
+static void BM_ChooseMoveGeneration(benchmark::State& state)
+{
+	const auto pool = positions((int) state.range(0), state.range(1) != 0,
+		Game::Stage::PLAYING);
+	std::size_t k = 0;
+	AllocationCounter counter(state);
+	for (auto _ : state) {
+		Game const& game = *pool[k];
+		BitBoard const& bits = game.getBits();
+		const int dim = bits.getDimension();
+		std::vector<std::tuple<int, int, int, int>> moves;
+		bits.forEachMove(game.getTurn(), [&](int from, int to) {
+			moves.push_back(std::make_tuple(from / dim, from % dim, to / dim, to % dim));
+		});
+		const BitMask capture_targets = bits.captureTargets(game.getTurn());
+		int captures = 0;
+		for (auto const& [i_ini, j_ini, i_fin, j_fin] : moves)
+			captures += capture_targets.test(bits.index(i_fin, j_fin));
+		benchmark::DoNotOptimize(moves.data());
+		benchmark::DoNotOptimize(captures);
+		k = k + 1 == pool.size() ? 0 : k + 1;
+	}
+}
+
+static void BM_LegalMoves(benchmark::State& state)
+{
+	const auto pool = positions((int) state.range(0), state.range(1) != 0,
+		Game::Stage::PLAYING);
+	std::size_t k = 0;
+	Move moves[Game::MAX_MOVES];
+	AllocationCounter counter(state);
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(pool[k]->getLegalMoves(moves));
+		benchmark::ClobberMemory();
+		k = k + 1 == pool.size() ? 0 : k + 1;
+	}
+}
+
+// Capture resolution (processMove) through a capturing move and its undo
+static void BM_CaptureMove(benchmark::State& state)
+{
+	auto pool = positions((int) state.range(0), state.range(1) != 0,
+		Game::Stage::PLAYING, hasCapture);
+	std::vector<Move> moves;
+	for (auto const& game : pool)
+		moves.push_back(captureMove(*game));
+	std::size_t k = 0;
+	AllocationCounter counter(state);
+	for (auto _ : state) {
+		Game::Undo undo;
+		pool[k]->makeMove(moves[k], undo);
+		benchmark::DoNotOptimize(undo.capture_count);
+		pool[k]->unmakeMove(undo);
+		k = k + 1 == pool.size() ? 0 : k + 1;
+	}
+}
+
+// The placement behind placePiecePrivate, and its undo
+static void BM_Placement(benchmark::State& state)
+{
+	auto pool = positions((int) state.range(0), state.range(1) != 0,
+		Game::Stage::PLACING_PIECES);
+	std::vector<int> cells;
+	for (auto const& game : pool) {
+		Move moves[Game::MAX_MOVES];
+		game->getLegalMoves(moves);
+		cells.push_back(moves[0].to);
+	}
+	std::size_t k = 0;
+	AllocationCounter counter(state);
+	for (auto _ : state) {
+		Game::Undo undo;
+		benchmark::DoNotOptimize(pool[k]->makePlacement(cells[k], undo));
+		pool[k]->unmakePlacement(undo);
+		k = k + 1 == pool.size() ? 0 : k + 1;
+	}
+}
+
+// Cell drawn by the random AI for its next piece
+static void BM_ChoosePlacement(benchmark::State& state)
+{
+	auto pool = positions((int) state.range(0), state.range(1) != 0,
+		Game::Stage::PLACING_PIECES);
+	std::size_t k = 0;
+	AllocationCounter counter(state);
+	for (auto _ : state) {
+		Move move;
+		benchmark::DoNotOptimize(pool[k]->chooseAiMove(move));
+		benchmark::DoNotOptimize(move);
+		k = k + 1 == pool.size() ? 0 : k + 1;
+	}
+}
+
+// Whole game of random play, placement included; "fixed" replays the
+// same seed, "random" a new one every time
+static void BM_RandomGame(benchmark::State& state)
+{
+	const int dim = (int) state.range(0);
+	const bool random = state.range(1) != 0;
+	unsigned int seed = 0;
+	unsigned long long plies = 0;
+	AllocationCounter counter(state);
+	for (auto _ : state) {
+		std::default_random_engine rng(seed);
+		Game game(dim, true, rng);
+		game.setVerbose(false);
+		while (!game.isOver() && game.getPlyCount() < MAX_PLIES)
+			if (!game.autoPlay())
+				break;
+		plies += game.getPlyCount();
+		if (random)
+			++seed;
+	}
+	state.counters["plies/op"] = benchmark::Counter(
+		(double) plies, benchmark::Counter::kAvgIterations);
+}
+
+// Hash of a position folded over its symmetries, as the TT keys it
+static void BM_CanonicalHash(benchmark::State& state)
+{
+	const auto pool = positions((int) state.range(0), state.range(1) != 0,
+		Game::Stage::PLAYING);
+	std::size_t k = 0;
+	AllocationCounter counter(state);
+	for (auto _ : state) {
+		int transform;
+		benchmark::DoNotOptimize(pool[k]->getCanonicalHash(transform));
+		benchmark::DoNotOptimize(transform);
+		k = k + 1 == pool.size() ? 0 : k + 1;
+	}
+}
+
+// One full batch of positions scored by the kernel of the given level
+// (0 scalar, 1 SSE2, 2 AVX2, capped at what the processor runs)
+static void BM_EvaluateBatch(benchmark::State& state)
+{
+	const int dim = (int) state.range(0);
+	const auto pool = positions(dim, true, Game::Stage::PLAYING);
+	const BatchEvaluator evaluator((SimdLevel) state.range(1));
+	state.SetLabel(BatchEvaluator::getName(evaluator.getLevel()));
+	EvalBatch batch(dim);
+	std::size_t k = 0;
+	AllocationCounter counter(state);
+	for (auto _ : state) {
+		batch.clear();
+		while (!batch.isFull()) {
+			batch.add(pool[k]->getBits(), pool[k]->getTurn());
+			k = k + 1 == pool.size() ? 0 : k + 1;
+		}
+		evaluator.evaluate(batch);
+		benchmark::DoNotOptimize(batch.score);
+	}
+	state.SetItemsProcessed(state.iterations() * EvalBatch::SIZE);
+}
+
+// Lazy SMP search of a 9x9 position for a fixed time: nodes per second of
+// all the threads together, and the share of the single thread rate that
+// each thread keeps ("efficiency", 1 for perfect scaling)
+static void BM_ParallelSearch(benchmark::State& state)
+{
+	static double single_rate = 0.;
+	const unsigned int threads = (unsigned int) state.range(0);
+	const auto pool = positions(9, false, Game::Stage::PLAYING);
+	SearchOptions options;
+	options.time_ms = 250;
+	options.threads = threads;
+	AlphaBeta search(options);
+	unsigned long long nodes = 0;
+	const auto start = std::chrono::steady_clock::now();
+	for (auto _ : state)
+		nodes += search.search(*pool[0]).stats.nodes;
+	const double seconds = std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - start).count();
+	const double rate = nodes / seconds;
+	if (threads == 1)
+		single_rate = rate;
+	state.counters["nodes/s"] = rate;
+	if (single_rate > 0.)
+		state.counters["efficiency"] = rate / (threads * single_rate);
+}
+
+#define SEEGA_BENCHMARK(name) \
+	BENCHMARK(name)->ArgsProduct({ { 5, 7, 9 }, { 0, 1 } })->ArgNames({ "dim", "random" })
+
+SEEGA_BENCHMARK(BM_HasPossibleMove);
+SEEGA_BENCHMARK(BM_ChooseMoveGeneration);
+SEEGA_BENCHMARK(BM_LegalMoves);
+SEEGA_BENCHMARK(BM_CaptureMove);
+SEEGA_BENCHMARK(BM_Placement);
+SEEGA_BENCHMARK(BM_ChoosePlacement);
+SEEGA_BENCHMARK(BM_RandomGame)->Unit(benchmark::kMicrosecond);
+SEEGA_BENCHMARK(BM_CanonicalHash);
+BENCHMARK(BM_EvaluateBatch)->ArgsProduct({ { 5, 7, 9 }, { 0, 1, 2 } })
+	->ArgNames({ "dim", "simd" });
+BENCHMARK(BM_ParallelSearch)->RangeMultiplier(2)->Range(1, 64)->ArgName("threads")
+	->Iterations(4)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -57,7 +57,7 @@ namespace argparser
 	class parser
 	{
 	public:
-		parser(arglist& list, Class& handle, const char* helpstr) :
+		parser(arglist&& list, Class& handle, const char* helpstr) :
 			list(list), handle(handle) {
 			parse_mode = list["help"].empty();
 			if (!parse_mode && helpstr)
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "alphabeta.h"
+#include "mcts.h"
+#include "tablebase.h"
+
+class Game;
+struct Move;
+
+// Strategy playing one side of a game. It only reads the game it is
+// given (copies it to think) and answers with the action of the player
+// to move. The opening book and the endgame tables of the game come
+// before any agent.
+class Agent
+{
+public:
+	virtual ~Agent();
+
+	// Picks the action of the player to move, placements being moves from
+	// and to the same cell. rng is the random stream of the game, so that
+	// seeded games play the same. Returns false if there is none.
+	virtual bool chooseMove(Game const& game, std::default_random_engine& rng,
+		Move& move) = 0;
+
+	// Thinks on the opponent's turn, the player to move in the game,
+	// until the stop flag is set (see Game::ponder). Returns false, at
+	// once, if the agent has nothing to gain from it.
+	virtual bool ponder(Game const& game);
+
+	// Searches stop, as at their deadline, once the flag is set
+	// (nullptr for none). The flag must outlive the searches.
+	virtual void setStopFlag(std::atomic<bool> const* stop);
+
+	// Forgets the last game before a new one, reseeding from rng
+	virtual void newGame(std::default_random_engine& rng);
+
+	// Totals of the searches made so far (none if the agent does not
+	// search with AlphaBeta)
+	virtual SearchStats getSearchTotals() const;
+};
+
+// Captures whenever it can, otherwise moves at random, and places its
+// pieces away from its other ones
+class RandomAgent : public Agent
+{
+public:
+	bool chooseMove(Game const& game, std::default_random_engine& rng,
+		Move& move) override;
+private:
+	// The same cell by cell, for boards too large for a bitboard
+	bool chooseOnBoard(Game const& game, std::default_random_engine& rng,
+		Move& move) const;
+};
+
+// Places as RandomAgent does and moves by alpha-beta search
+class SearchAgent : public Agent
+{
+public:
+	explicit SearchAgent(std::shared_ptr<AlphaBeta> search);
+	std::shared_ptr<AlphaBeta> getSearch() const;
+
+	bool chooseMove(Game const& game, std::default_random_engine& rng,
+		Move& move) override;
+	bool ponder(Game const& game) override;
+	void setStopFlag(std::atomic<bool> const* stop) override;
+	void newGame(std::default_random_engine& rng) override;
+	SearchStats getSearchTotals() const override;
+private:
+	std::shared_ptr<AlphaBeta> m_search;
+	RandomAgent m_placement;
+};
+
+// Places and moves by Monte Carlo tree search
+class MctsAgent : public Agent
+{
+public:
+	explicit MctsAgent(std::shared_ptr<Mcts> mcts);
+	std::shared_ptr<Mcts> getMcts() const;
+
+	bool chooseMove(Game const& game, std::default_random_engine& rng,
+		Move& move) override;
+	bool ponder(Game const& game) override;
+	void setStopFlag(std::atomic<bool> const* stop) override;
+	void newGame(std::default_random_engine& rng) override;
+private:
+	std::shared_ptr<Mcts> m_mcts;
+};
+
+// Everything the built-in agents are made from
+struct AgentOptions
+{
+	SearchOptions search;
+	MctsOptions mcts;
+	std::shared_ptr<Tablebase const> tablebase; // for the searches
+};
+
+// Agents by name, so that programs can pit any two against each other
+// from the command line. The built-in ones are "aleatorio" (RandomAgent),
+// "alfabeta" (SearchAgent) and "mcts" (MctsAgent). New ones are added at
+// startup, before any thread creates agents.
+class AgentRegistry
+{
+public:
+	using Factory = std::function<std::shared_ptr<Agent>(AgentOptions const&)>;
+public:
+	static AgentRegistry& instance();
+
+	// Returns false, changing nothing, if the name is taken
+	bool add(std::string const& name, std::string const& description,
+		Factory factory);
+
+	// A new agent, or nullptr if no agent has the name
+	std::shared_ptr<Agent> create(std::string const& name,
+		AgentOptions const& options) const;
+
+	bool contains(std::string const& name) const;
+	// In the order they were added
+	std::vector<std::string> getNames() const;
+	std::string getDescription(std::string const& name) const;
+	// "a, b ou c", for the help of the programs
+	std::string listNames() const;
+private:
+	AgentRegistry();
+
+	struct Entry
+	{
+		std::string name;
+		std::string description;
+		Factory factory;
+	};
+
+	Entry const* find(std::string const& name) const;
+private:
+	std::vector<Entry> m_entries;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+
+#include "game.h"
+
+// Thinks for the AI on a thread of its own, so the caller (the GLUT main
+// loop) never blocks on a search. start() hands it a copy of the game,
+// and poll() returns the chosen move once it is ready, to be played with
+// Game::playAiMove(). The search is bounded by the deadline of the
+// engine the game uses. cancel() stops it early and drops its result.
+// Between moves it can ponder on the human's turn instead.
+class AiWorker
+{
+public:
+	explicit AiWorker(unsigned int seed);
+	~AiWorker(); // cancels and joins
+	AiWorker(AiWorker const&) = delete;
+	AiWorker& operator=(AiWorker const&) = delete;
+
+	// Starts thinking for the player to move, cancelling any earlier job
+	void start(Game const& game);
+
+	// Searches the position while the human is to move, until the next
+	// start() or cancel(), so the AI's next search starts warm (see
+	// Game::ponder). Reports no move and does not make the worker busy.
+	void ponder(Game const& game);
+
+	// True once for each finished job, with its move; false while thinking
+	// and when there was no legal move
+	bool poll(Move& move);
+
+	// Between start() and the poll() that returns its move
+	bool isBusy() const;
+
+	// Stops the search in progress, if any; its move is never reported
+	void cancel();
+private:
+	void post(Game const& game, bool ponders);
+	void run();
+private:
+	mutable std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::unique_ptr<Game> m_job;  // waiting to be picked up
+	bool m_job_ponders;
+	std::uint64_t m_generation;   // bumped by every new job and cancel()
+	bool m_busy;
+	bool m_has_result;
+	bool m_found;                 // whether the result has a move
+	Move m_result;
+	bool m_quit;
+	std::atomic<bool> m_stop;     // read by the search engines
+	std::default_random_engine m_rng;
+	std::thread m_thread;         // last, started once the rest is ready
+};
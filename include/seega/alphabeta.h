@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "evaluator.h"
+#include "game.h"
+#include "tablebase.h"
+#include "transposition.h"
+
+struct SearchOptions
+{
+	int max_depth = 64;
+	unsigned long time_ms = 1000; // 0 = no deadline
+	std::size_t hash_mb = 16; // transposition table size, 0 = none
+	// Keys the table by the canonical image of each position, so that its
+	// rotations and reflections share one entry (every search sharing a
+	// table must agree on it)
+	bool symmetry = false;
+	unsigned int threads = 1; // 0 = one per hardware core
+};
+
+struct SearchStats
+{
+	unsigned long long nodes = 0;
+	unsigned long long tt_probes = 0;
+	unsigned long long tt_hits = 0;
+	unsigned long long tt_collisions = 0; // slot held another position
+	unsigned long long tb_hits = 0; // nodes settled by the endgame tables
+
+	SearchStats& operator+=(SearchStats const& other);
+};
+
+struct SearchResult
+{
+	Move move;
+	int score; // from the point of view of the player to move
+	int depth; // deepest iteration fully searched
+	SearchStats stats;
+};
+
+// Negamax alpha-beta search with iterative deepening for the movement
+// stage. The move stored in the transposition table is searched first,
+// then the capturing moves. When the deadline hits, the best move of the
+// deepest finished iteration is returned. Positions covered by the
+// endgame tables, if given, are not searched any further.
+//
+// With more than one thread the search is a Lazy SMP one: helper threads
+// run the same iterative deepening on their own, from another root move
+// and every other one a depth ahead, and only meet through the shared
+// transposition table, where each finds the others' results. They stop
+// when the main thread is done, and the deepest iteration finished by
+// any thread gives the move.
+class AlphaBeta
+{
+public:
+	static constexpr int WIN_SCORE = 1000000;
+	static constexpr int MAX_PLY = 128;
+	static constexpr int MAX_MOVES = 4 * BitBoard::MAX_DIM * BitBoard::MAX_DIM;
+	static constexpr int LEAF_BLOCK = 1; // first batch of leaves of a node
+public:
+	// Without a table given, one of options.hash_mb is made
+	explicit AlphaBeta(SearchOptions const& options = SearchOptions(),
+		std::shared_ptr<TranspositionTable> tt = nullptr);
+	SearchOptions const& getOptions() const;
+	std::shared_ptr<TranspositionTable> getTable() const;
+
+	// Totals over every search made so far, helpers included
+	SearchStats const& getTotals() const;
+
+	void setTablebase(std::shared_ptr<Tablebase const> tablebase);
+
+	// Searches also stop, as at the deadline, once the flag is set
+	// (nullptr for none). The flag must outlive the searches.
+	void setStopFlag(std::atomic<bool> const* stop);
+
+	// The player to move must have at least one legal move
+	SearchResult search(Game const& game);
+
+	// Searches with no deadline, until the stop flag is set or the depth
+	// limit is reached, only to fill the transposition table while the
+	// opponent (the player to move) thinks. Returns their expected move.
+	Move ponder(Game const& game);
+private:
+	// Helper thread of the main search
+	AlphaBeta(AlphaBeta const& main, unsigned int index);
+
+	// Iterative deepening of one thread
+	SearchResult searchRoot(Game const& game);
+	int negamax(Game& game, int depth, int alpha, int beta, int ply);
+	int searchChild(Game& game, Move move, int depth,
+		int alpha, int beta, int ply);
+	// Search of the children of a node at depth 1, evaluating them in
+	// batches
+	int searchLeaves(Game& game, Move const* moves, int count,
+		int alpha, int beta, int ply, Move& best_move);
+	int generateMoves(Game const& game, Move* moves) const;
+	// Key of the position in the table, and the symmetry taking its moves
+	// to the ones stored (0 unless SearchOptions::symmetry is set)
+	std::uint64_t tableKey(Game const& game, int& transform) const;
+	bool probe(std::uint64_t key, TTEntry& entry);
+	bool probeTablebase(Game const& game, int ply, int& score);
+	int evaluate(Game const& game) const;
+	bool outOfTime();
+	// Counts the call and, every few calls, looks at the deadline and the
+	// stop flag; true once the search is to stop
+	bool shouldStop();
+private:
+	SearchOptions m_options;
+	std::shared_ptr<TranspositionTable> m_tt;
+	std::shared_ptr<Tablebase const> m_tablebase;
+	BatchEvaluator m_evaluator;
+	std::unique_ptr<EvalBatch> m_batch; // sized for the last board seen
+	std::chrono::steady_clock::time_point m_deadline;
+	std::atomic<bool> const* m_stop_flag;
+	bool m_pondering;
+	SearchStats m_stats;
+	SearchStats m_totals;
+	bool m_stopped;
+	unsigned int m_calls; // of negamax and searchLeaves
+	unsigned int m_index; // 0 for the main search, then the helpers
+	std::vector<std::unique_ptr<AlphaBeta>> m_helpers;
+	std::atomic<bool> m_helpers_stop;
+};
@@ -0,0 +1,269 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+enum class Cell;
+
+// 128-bit set of cells, one bit per cell in row-major order
+// (bit i * dim + j stands for cell (i, j))
+struct BitMask
+{
+	std::uint64_t lo, hi;
+
+	constexpr BitMask() : lo(0), hi(0) {}
+	constexpr BitMask(std::uint64_t lo, std::uint64_t hi) : lo(lo), hi(hi) {}
+
+	static constexpr BitMask bit(int n)
+	{
+		return n < 64 ? BitMask(std::uint64_t(1) << n, 0)
+		              : BitMask(0, std::uint64_t(1) << (n - 64));
+	}
+
+	constexpr bool any() const { return (lo | hi) != 0; }
+	constexpr bool test(int n) const
+	{
+		return n < 64 ? ((lo >> n) & 1) != 0 : ((hi >> (n - 64)) & 1) != 0;
+	}
+
+	int count() const;
+	int lowest() const;
+	int highest() const;
+
+	// Removes the lowest cell from the set and returns its index
+	int pop()
+	{
+		const int n = lowest();
+		if (lo)
+			lo &= lo - 1;
+		else
+			hi &= hi - 1;
+		return n;
+	}
+};
+
+inline int BitMask::count() const
+{
+#if defined(_MSC_VER)
+	return (int) (__popcnt64(lo) + __popcnt64(hi));
+#else
+	return __builtin_popcountll(lo) + __builtin_popcountll(hi);
+#endif
+}
+
+inline int BitMask::lowest() const
+{
+#if defined(_MSC_VER)
+	unsigned long n;
+	if (_BitScanForward64(&n, lo))
+		return (int) n;
+	_BitScanForward64(&n, hi);
+	return (int) n + 64;
+#else
+	return lo ? __builtin_ctzll(lo) : __builtin_ctzll(hi) + 64;
+#endif
+}
+
+inline int BitMask::highest() const
+{
+#if defined(_MSC_VER)
+	unsigned long n;
+	if (_BitScanReverse64(&n, hi))
+		return (int) n + 64;
+	_BitScanReverse64(&n, lo);
+	return (int) n;
+#else
+	return hi ? 127 - __builtin_clzll(hi) : 63 - __builtin_clzll(lo);
+#endif
+}
+
+constexpr BitMask operator&(BitMask a, BitMask b) { return { a.lo & b.lo, a.hi & b.hi }; }
+constexpr BitMask operator|(BitMask a, BitMask b) { return { a.lo | b.lo, a.hi | b.hi }; }
+constexpr BitMask operator^(BitMask a, BitMask b) { return { a.lo ^ b.lo, a.hi ^ b.hi }; }
+constexpr BitMask operator~(BitMask a) { return { ~a.lo, ~a.hi }; }
+constexpr bool operator==(BitMask a, BitMask b) { return a.lo == b.lo && a.hi == b.hi; }
+constexpr bool operator!=(BitMask a, BitMask b) { return !(a == b); }
+inline BitMask& operator&=(BitMask& a, BitMask b) { return a = a & b; }
+inline BitMask& operator|=(BitMask& a, BitMask b) { return a = a | b; }
+inline BitMask& operator^=(BitMask& a, BitMask b) { return a = a ^ b; }
+
+// Shifts are only ever done by 1 or by the board dimension,
+// so 0 < n < 64 always holds
+constexpr BitMask operator<<(BitMask a, int n)
+{
+	return { a.lo << n, (a.hi << n) | (a.lo >> (64 - n)) };
+}
+
+constexpr BitMask operator>>(BitMask a, int n)
+{
+	return { (a.lo >> n) | (a.hi << (64 - n)), a.hi >> n };
+}
+
+// Shape of the board as masks, for the kernels of BitBoard.
+// FixedGeometry knows the size at compile time, so every shift and mask
+// of a kernel folds to a constant; RuntimeGeometry serves any size.
+namespace geometry
+{
+	// Cells (i, j) of a dim x dim board with first <= j <= last
+	constexpr BitMask columns(int dim, int first, int last)
+	{
+		BitMask mask;
+		for (int i = 0; i < dim; ++i)
+			for (int j = first; j <= last; ++j)
+				mask = mask | BitMask::bit(i * dim + j);
+		return mask;
+	}
+
+	constexpr BitMask center(int dim)
+	{
+		return BitMask::bit(dim / 2 * dim + dim / 2);
+	}
+}
+
+template<int N>
+struct FixedGeometry
+{
+	static constexpr int dim = N;
+	static constexpr BitMask valid = geometry::columns(N, 0, N - 1);
+	static constexpr BitMask not_west = geometry::columns(N, 1, N - 1);
+	static constexpr BitMask not_east = geometry::columns(N, 0, N - 2);
+	static constexpr BitMask center = geometry::center(N);
+};
+
+struct RuntimeGeometry
+{
+	int dim;
+	BitMask valid;
+	BitMask not_west; // every cell but the ones in the first column
+	BitMask not_east; // every cell but the ones in the last column
+	BitMask center;
+
+	explicit RuntimeGeometry(int dim) :
+		dim(dim),
+		valid(geometry::columns(dim, 0, dim - 1)),
+		not_west(geometry::columns(dim, 1, dim - 1)),
+		not_east(geometry::columns(dim, 0, dim - 2)),
+		center(geometry::center(dim))
+	{
+	}
+};
+
+// Board stored as one bit mask per color. Every kernel works on
+// whole masks at once by shifting them one cell in each direction.
+class BitBoard
+{
+public:
+	static constexpr int MAX_DIM = 11;
+public:
+	// Throws std::invalid_argument unless 0 < dim <= MAX_DIM
+	BitBoard(int dim);
+	int getDimension() const { return m_geometry.dim; }
+	int index(int i, int j) const { return i * m_geometry.dim + j; }
+
+	Cell get(int n) const;
+	void set(int n, Cell cell);
+
+	// Replaces every piece on the board at once
+	void setPieces(BitMask yellow, BitMask red);
+
+	BitMask pieces(Cell player) const;
+	BitMask empty() const { return m_geometry.valid & ~(m_pieces[0] | m_pieces[1]); }
+	BitMask valid() const { return m_geometry.valid; }
+	BitMask center() const { return m_geometry.center; }
+
+	// Cells right north/south/west/east of the cells in the mask
+	BitMask north(BitMask m) const { return north(m_geometry, m); }
+	BitMask south(BitMask m) const { return south(m_geometry, m); }
+	BitMask west(BitMask m) const { return west(m_geometry, m); }
+	BitMask east(BitMask m) const { return east(m_geometry, m); }
+
+	// Empty cells adjacent to a piece of the player, kept up to date by
+	// set() and setPieces(), so asking costs nothing
+	BitMask frontier(Cell player) const { return m_frontier[(int) player - 1]; }
+	bool hasMove(Cell player) const { return frontier(player).any(); }
+
+	// Empty cells where a piece of the player would capture on arrival
+	BitMask captureTargets(Cell player) const;
+
+	// Enemy pieces captured by the player's piece lying on cell n
+	BitMask captures(int n, Cell player) const;
+	// The same with the pieces given, for a board not built
+	BitMask captures(int n, BitMask own, BitMask enemies) const;
+
+	// Calls f(from, to) for every legal move of the player, in the same
+	// order as a row-major scan of the empty cells that looks north,
+	// west, south and east of each one
+	template<class F>
+	void forEachMove(Cell player, F f) const;
+
+	// Calls f with the geometry of the board: a FixedGeometry for the
+	// standard sizes (5, 7 and 9), the runtime one otherwise
+	template<class F>
+	decltype(auto) withGeometry(F f) const;
+private:
+	// Cells a piece of the player would arrive at by moving south, east,
+	// north and west, in that order (that is, coming from the north,
+	// west, south and east of them)
+	void moveSources(Cell player, BitMask* from) const;
+
+	// Frontiers from scratch, after all the pieces changed
+	void computeFrontiers();
+
+	// Cells adjacent to each cell of a dim x dim board
+	static BitMask const* neighborTable(int dim);
+
+	template<class G>
+	static BitMask north(G const& g, BitMask m) { return m >> g.dim; }
+	template<class G>
+	static BitMask south(G const& g, BitMask m) { return (m << g.dim) & g.valid; }
+	template<class G>
+	static BitMask west(G const& g, BitMask m) { return (m & g.not_west) >> 1; }
+	template<class G>
+	static BitMask east(G const& g, BitMask m) { return (m & g.not_east) << 1; }
+private:
+	RuntimeGeometry m_geometry;
+	BitMask const* m_neighbors;
+	BitMask m_pieces[2];
+	BitMask m_frontier[2];
+};
+
+template<class F>
+decltype(auto) BitBoard::withGeometry(F f) const
+{
+	switch (m_geometry.dim) {
+	case 5:
+		return f(FixedGeometry<5>());
+	case 7:
+		return f(FixedGeometry<7>());
+	case 9:
+		return f(FixedGeometry<9>());
+	default:
+		return f(m_geometry);
+	}
+}
+
+template<class F>
+void BitBoard::forEachMove(Cell player, F f) const
+{
+	BitMask from[4];
+	moveSources(player, from);
+	// Copies the callback cannot alias, so they stay in registers
+	const BitMask from_north = from[0], from_west = from[1];
+	const BitMask from_south = from[2], from_east = from[3];
+	const int dim = m_geometry.dim;
+	BitMask targets = frontier(player);
+	while (targets.any()) {
+		const int n = targets.pop();
+		if (from_north.test(n))
+			f(n - dim, n);
+		if (from_west.test(n))
+			f(n - 1, n);
+		if (from_south.test(n))
+			f(n + dim, n);
+		if (from_east.test(n))
+			f(n + 1, n);
+	}
+}
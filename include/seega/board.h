@@ -1,7 +1,12 @@
 #pragma once
 
+#include <array>
+#include <cassert>
+#include <cstddef>
 #include <vector>
 
+#include "bitboard.h"
+
 enum class Cell
 {
 	EMPTY,
@@ -9,17 +14,41 @@ enum class Cell
 	RED
 };
 
+// Cells stored row after row in one fixed array, big enough for any
+// board up to BitBoard::MAX_DIM, so such a board never allocates and
+// copies in one go. Larger boards, which only the slow rules of Game
+// play, keep their cells on the heap instead.
+// board[i] points to row i, so board[i][j] is cell (i, j).
 class Board
 {
+public:
+	static constexpr int MAX_CELLS = BitBoard::MAX_DIM * BitBoard::MAX_DIM;
 public:
 	Board(int dim);
 	int getDimension() const;
-	std::vector<Cell> const& operator[](std::size_t i) const;
+	Cell const* operator[](std::size_t i) const
+	{
+		assert(i < (std::size_t) m_dim);
+		return getCells() + i * m_dim;
+	}
 private:
-	std::vector<Cell>& operator[](std::size_t i);
+	Cell* operator[](std::size_t i)
+	{
+		assert(i < (std::size_t) m_dim);
+		return getCells() + i * m_dim;
+	}
+	Cell const* getCells() const
+	{
+		return m_large_cells.empty() ? m_cells.data() : m_large_cells.data();
+	}
+	Cell* getCells()
+	{
+		return m_large_cells.empty() ? m_cells.data() : m_large_cells.data();
+	}
 private:
 	int m_dim;
-	std::vector<std::vector<Cell>> m_cells;
+	std::array<Cell, MAX_CELLS> m_cells;
+	std::vector<Cell> m_large_cells; // empty up to BitBoard::MAX_DIM
 private:
 	friend class Game;
-};
\ No newline at end of file
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+
+#include "bitboard.h"
+
+// Block of positions of the same size, laid out as one array per bit
+// mask half (structure of arrays), so that a SIMD kernel loads the same
+// mask of several positions with one instruction
+struct EvalBatch
+{
+	static constexpr int SIZE = 32;
+
+	RuntimeGeometry geometry;
+	int count;
+	alignas(32) std::uint64_t own_lo[SIZE];
+	alignas(32) std::uint64_t own_hi[SIZE];
+	alignas(32) std::uint64_t enemy_lo[SIZE];
+	alignas(32) std::uint64_t enemy_hi[SIZE];
+	alignas(32) std::int32_t score[SIZE]; // filled by BatchEvaluator
+
+	explicit EvalBatch(int dim);
+
+	void clear() { count = 0; }
+	bool isFull() const { return count == SIZE; }
+
+	// Queues the position as seen by the player; returns its lane
+	int add(BitBoard const& bits, Cell player);
+	int add(BitMask own, BitMask enemy);
+};
+
+enum class SimdLevel
+{
+	SCALAR,
+	SSE2,
+	AVX2
+};
+
+// Scores whole batches with the widest kernel the processor runs,
+// chosen once at construction. Every kernel gives the same score as
+// evaluate(): 100 per piece ahead, plus one per empty cell next to the
+// player's pieces and minus one per empty cell next to the enemy's.
+class BatchEvaluator
+{
+public:
+	// Best level supported by the processor running the program
+	static SimdLevel detect();
+	static const char* getName(SimdLevel level);
+
+	// A level above detect() falls back to it
+	explicit BatchEvaluator(SimdLevel level = detect());
+	SimdLevel getLevel() const { return m_level; }
+
+	void evaluate(EvalBatch& batch) const;
+
+	// The same score for one position
+	static int evaluate(BitBoard const& bits, Cell player);
+private:
+	SimdLevel m_level;
+	void (*m_kernel)(EvalBatch&);
+};
@@ -1,11 +1,28 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <random>
+#include <vector>
+
+#include "bitboard.h"
+#include "placementsampler.h"
 
 class Board;
+class Agent;
+class Tablebase;
+class OpeningBook;
+class GameRecord;
 enum class Cell;
 
+// Move of a piece between two adjacent cells, given by their
+// row-major indices (i * dim + j)
+struct Move
+{
+	std::uint16_t from, to;
+};
+
 class Game
 {
 public:
@@ -15,9 +32,34 @@ public:
 		PLAYING,
 		END,
 	};
+public:
+	static constexpr int MAX_MOVES = 4 * BitBoard::MAX_DIM * BitBoard::MAX_DIM;
 public:
 	Game(int dim, bool ai, std::default_random_engine& rng);
+	// Game between two players where first moves first, to replay one.
+	// Throws std::invalid_argument if first is Cell::EMPTY.
+	Game(int dim, Cell first);
+	Game(Game const& other); // Deep copy, board included
+	Game& operator=(Game const&) = delete;
+
+	// State needed to take back a move or a placement. It has a fixed
+	// size, so walking a game tree in place never allocates.
+	struct Undo
+	{
+		Move move; // a placement is a move from and to the same cell
+		std::uint16_t captured[4];
+		int capture_count;
+		int yellow_pieces, red_pieces;
+		int remaining_pieces_to_place;
+		int ply_count;
+		int last_move[4];
+		std::uint64_t hash;
+		Stage stage;
+		Cell turn;
+	};
 	std::shared_ptr<Board const> getBoard() const;
+	// The pieces as bit masks, on boards up to BitBoard::MAX_DIM only
+	BitBoard const& getBits() const;
 
 	Cell getTurn() const;
 	Cell getAiColor() const;
@@ -25,8 +67,68 @@ public:
 
 	bool letAiPlay();
 
+	// Lets the AI play the current turn, whichever color it is (self-play)
+	bool autoPlay();
+
+	// The two halves of autoPlay(), so the thinking can happen on a copy
+	// in another thread: chooseAiMove() picks the action for the player to
+	// move, placements being moves from and to the same cell, and
+	// playAiMove() plays it for the AI. Both return false, changing
+	// nothing, if there is none or it is illegal or not the AI's turn.
+	bool chooseAiMove(Move& move);
+	bool playAiMove(Move move);
+
+	// Searches the position with the AI engine while the human is to
+	// move, until the stop flag is set, so the search of the AI's next
+	// turn starts from the work done (pondering). Returns false, at once,
+	// when there is nothing to ponder: no engine, the AI to move, or the
+	// position in the endgame tables.
+	bool ponder();
+
+	// Records every placement and move played from now on through
+	// placePiece, movePiece and the AI, but not make/unmake, into the
+	// record (nullptr to stop). Give it before the first ply. Copies of
+	// the game do not record.
+	void setRecord(std::shared_ptr<GameRecord> record);
+
+	// Restarts the random choices of the AI from the seed
+	void reseed(unsigned int seed);
+
+	// Stops the search of the AI, as at its deadline, once the flag is
+	// set (nullptr for none). The search engines are shared by copies.
+	void setStopFlag(std::atomic<bool> const* stop);
+
 	Stage getStage() const;
 	bool isOver() const;
+	Cell getWinner() const;
+	int getPlyCount() const;
+	bool hasPossibleMove(Cell player) const;
+
+	// Zobrist hash of the position, kept up to date move by move. Above
+	// BitBoard::MAX_DIM it only tells the turn apart.
+	std::uint64_t getHash() const;
+
+	// Hash shared by the 8 rotations and reflections of the position;
+	// sets the symmetry that takes this one to the canonical image
+	std::uint64_t getCanonicalHash(int& transform) const;
+
+	// Prints the winner to the standard output when the game ends
+	void setVerbose(bool verbose);
+
+	// Makes the agent pick the actions of the player (nullptr goes back to
+	// RandomAgent). Agents are shared by copies of the game.
+	void setAgent(Cell player, std::shared_ptr<Agent> agent);
+	// The same agent for both players
+	void setAgent(std::shared_ptr<Agent> agent);
+	std::shared_ptr<Agent> getAgent(Cell player) const;
+
+	// Makes the AI play perfectly once few enough pieces are left for
+	// the endgame tables (nullptr to stop)
+	void setTablebase(std::shared_ptr<Tablebase const> tablebase);
+
+	// Makes the AI place its pieces as the book says while the position
+	// is in it, before any search (nullptr to stop)
+	void setOpeningBook(std::shared_ptr<OpeningBook const> book);
 
 	bool canPlacePieces() const;
 	bool canMovePieces() const;
@@ -36,25 +138,63 @@ public:
 
 	int const* getLastMove() const;
 	std::vector<std::pair<int, int>> const& getLastRemoved() const;
+
+	// Fills the array (of at least MAX_MOVES) with the legal actions of
+	// the player to move and returns how many there are. Placements are
+	// moves from and to the same cell. None above BitBoard::MAX_DIM, where
+	// there may be more than MAX_MOVES.
+	int getLegalMoves(Move* moves) const;
+
+	// Rule-checked move and placement for lookahead, with no output and
+	// no allocation. They return false, leaving the game untouched, if
+	// illegal. Undo them in reverse order with the matching unmake call.
+	// getLastRemoved() only follows placePiece and movePiece.
+	bool makeMove(Move move, Undo& undo);
+	void unmakeMove(Undo const& undo);
+	bool makePlacement(int n, Undo& undo);
+	void unmakePlacement(Undo const& undo);
 private:
 	bool placePiecePrivate(int i, int j);
 	bool movePiecePrivate(int i_ini, int j_ini, int i_fin, int j_fin);
 
+	void setCell(int i, int j, Cell cell);
 	void nextTurn();
 	void addPlacedPieces();
-	void processMove(int i, int j);
+	void processMove(int i, int j, Undo& undo);
+	void saveState(Undo& undo) const;
+	void restoreState(Undo const& undo);
 	Cell getEnemy(Cell me) const;
 	void eliminateCell(int i, int j);
 	bool isCentralCell(int i, int j) const;
-	bool hasPossibleMove(Cell player) const;
+	bool isHalfTurn() const;
+	bool inTablebase() const;
+
+	// Boards above BitBoard::MAX_DIM leave the bitboard unused and play
+	// by these slower rules over the Board, with the random AI only
+	bool isLarge() const;
+	bool boardHasMove(Cell player) const;
+	// Cells of the enemy captured by a piece of the player arriving at
+	// (i, j), into captured (of 4); returns how many
+	int boardCaptures(int i, int j, Cell player, int* captured) const;
 
-	bool chooseCellToPlace();
-	bool chooseMove();
+	bool applyMove(Move move);
+private:
+	friend class AlphaBeta;
+	friend class RandomAgent;
 private:
 	std::shared_ptr<Board> m_board;
+	BitBoard m_bits;
+	PlacementSampler m_placement; // kept by the placements only
+	std::uint64_t m_hash;
 	int m_yellow_pieces, m_red_pieces;
 	int m_remaining_pieces_to_place;
+	int m_ply_count;
+	bool m_verbose;
 	std::default_random_engine m_rng;
+	std::shared_ptr<Agent> m_agents[2]; // by player
+	std::shared_ptr<Tablebase const> m_tablebase;
+	std::shared_ptr<OpeningBook const> m_book;
+	std::shared_ptr<GameRecord> m_record;
 	bool m_ai;
 	std::vector<std::pair<int, int>> m_last_removed;
 	int m_last_move[4];
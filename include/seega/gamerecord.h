@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "game.h"
+#include "mappedfile.h"
+
+// Placements and moves of one game, bit-packed as they are played. The
+// placements are always the first dim * dim - 1 plies, so each one is a
+// cell index and each move a cell index and a direction (2 bits), with
+// the cell index in as few bits as the board size allows: 5 on 5x5, 6 on
+// 7x7, 7 on 9x9. A game records into it once given to Game::setRecord().
+class GameRecord
+{
+public:
+	GameRecord();
+
+	// Forgets every ply and starts over (Game::setRecord calls it)
+	void begin(int dim, Cell first);
+	void add(Move move);
+
+	// Where the game came from, to reproduce it: the seed of a self-play
+	// run and the number of the game in it, say
+	void setOrigin(std::uint32_t seed, std::uint64_t number);
+
+	int getDimension() const { return m_dim; }
+	Cell getFirstPlayer() const { return m_first; }
+	std::uint32_t getSeed() const { return m_seed; }
+	std::uint64_t getNumber() const { return m_number; }
+	int getPlyCount() const { return m_plies; }
+	std::vector<unsigned char> const& getBytes() const { return m_bytes; }
+
+	static int cellBits(int dim);
+private:
+	void put(unsigned int value, int bits);
+private:
+	int m_dim;
+	int m_cell_bits;
+	Cell m_first;
+	std::uint32_t m_seed;
+	std::uint64_t m_number;
+	int m_plies;
+	int m_bit; // next bit to write in m_bytes
+	std::vector<unsigned char> m_bytes;
+};
+
+// One game of a mapped record file, read in place. Any ply decodes in
+// constant time, since its bit offset follows from the ply number.
+class RecordView
+{
+public:
+	RecordView();
+
+	int getDimension() const { return m_dim; }
+	Cell getFirstPlayer() const { return m_first; }
+	Cell getWinner() const { return m_winner; } // EMPTY if unfinished
+	std::uint32_t getSeed() const { return m_seed; }
+	std::uint64_t getNumber() const { return m_number; }
+	int getPlyCount() const { return m_plies; }
+
+	// Placements are moves from and to the same cell
+	Move getMove(int ply) const;
+private:
+	friend class RecordReader;
+
+	unsigned int get(std::size_t bit, int bits) const;
+private:
+	unsigned char const* m_data; // packed plies
+	int m_dim;
+	int m_cell_bits;
+	Cell m_first;
+	Cell m_winner;
+	std::uint32_t m_seed;
+	std::uint64_t m_number;
+	int m_plies;
+};
+
+// Appends finished games to a record file, never seeking back, so any
+// number of them streams through the file buffer. close() then appends
+// the block index, which holds the offset of every BLOCK_GAMES-th game.
+// Threads may share a writer; the games land in the order of the calls.
+//
+// File layout, little-endian:
+//   u32 magic, u32 version, u32 games per block, u32 zero
+//   for each game: u8 dimension, u8 first player, u8 winner, u8 zero,
+//     u32 plies, u32 seed, u64 number, then the packed plies
+//   u64 offset of each block, then u64 index offset, u64 games, u32 magic
+class RecordWriter
+{
+public:
+	static constexpr std::uint32_t BLOCK_GAMES = 1024;
+public:
+	RecordWriter();
+	~RecordWriter(); // closes
+
+	// Creates the file, replacing any other
+	bool open(std::string const& path);
+	bool write(GameRecord const& record, Cell winner);
+	bool close();
+
+	std::uint64_t getGameCount() const;
+private:
+	mutable std::mutex m_mutex;
+	std::ofstream m_out;
+	std::uint64_t m_offset;
+	std::uint64_t m_games;
+	std::vector<std::uint64_t> m_index;
+};
+
+// Reads a record file through a memory mapping, with no copies. A file
+// whose writer never closed it (no index) is still read: the index is
+// then rebuilt by walking the games once.
+class RecordReader
+{
+public:
+	RecordReader();
+
+	bool open(std::string const& path);
+	bool isOpen() const;
+	std::uint64_t getGameCount() const;
+
+	// Game n, found from the block index by skipping at most
+	// BLOCK_GAMES - 1 game headers. False if past the end.
+	bool getGame(std::uint64_t n, RecordView& view) const;
+
+	// Calls f(RecordView const&) on every game, in file order
+	template<class F>
+	void forEachGame(F f) const
+	{
+		RecordView view;
+		for (std::size_t offset = m_begin; parse(offset, view); )
+			f(view);
+	}
+private:
+	// Reads the game at offset and moves offset past it
+	bool parse(std::size_t& offset, RecordView& view) const;
+private:
+	MappedFile m_file;
+	std::size_t m_begin; // first game
+	std::size_t m_end;   // past the last game
+	std::uint64_t m_games;
+	std::vector<std::uint64_t> m_index;
+};
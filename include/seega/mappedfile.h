@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file. Every thread may read the
+// data at once; the pages are shared with any other process mapping
+// the same file.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+	MappedFile(MappedFile const&) = delete;
+	MappedFile& operator=(MappedFile const&) = delete;
+
+	// Maps the file, dropping any previous mapping. Returns false if the
+	// file cannot be opened or is empty.
+	bool open(std::string const& path);
+	void close();
+
+	bool isOpen() const { return m_data != nullptr; }
+	unsigned char const* getData() const { return m_data; }
+	std::size_t getSize() const { return m_size; }
+private:
+	unsigned char const* m_data;
+	std::size_t m_size;
+#if defined(_WIN32)
+	void* m_file;
+	void* m_mapping;
+#endif
+};
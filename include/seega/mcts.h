@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+
+#include "game.h"
+#include "tablebase.h"
+
+struct MctsOptions
+{
+	unsigned long time_ms = 1000;        // 0 = no deadline
+	unsigned long long max_playouts = 0; // 0 = no limit
+	std::size_t max_nodes = 1 << 20;     // size of the node arena
+	unsigned int threads = 1;            // 0 = one per hardware core
+	double exploration = 1.4;
+	int max_playout_plies = 200;         // then scored by material
+	unsigned int seed = 0;
+};
+
+struct MctsResult
+{
+	Move move;
+	unsigned long long playouts;
+	std::size_t nodes; // arena nodes in use after the search
+	double value;      // expected score of the move, 0 (loss) to 1 (win)
+};
+
+// Monte Carlo tree search for both the placement and the movement stage.
+// Children are picked by UCT and every thread runs its own playouts on
+// the shared tree; a thread descending through a node counts as a loss
+// for it until the playout is back (virtual loss), which spreads the
+// threads over different lines. Playouts follow the random AI: capture
+// when possible, otherwise move or place at random; the ones cut short
+// are scored by the share of the material each side has left, and the
+// ones reaching a position covered by the endgame tables by its value.
+// Nodes come from a fixed arena. When the new position was already in
+// the tree a few plies below the last root, that subtree is kept.
+class Mcts
+{
+public:
+	explicit Mcts(MctsOptions const& options = MctsOptions());
+	~Mcts();
+	MctsOptions const& getOptions() const;
+	void setTablebase(std::shared_ptr<Tablebase const> tablebase);
+
+	// Searches also stop, as at the deadline, once the flag is set
+	// (nullptr for none). The flag must outlive the searches.
+	void setStopFlag(std::atomic<bool> const* stop);
+
+	// Drops the tree and reseeds the playouts
+	void reset(unsigned int seed);
+
+	// The player to move must have at least one legal action
+	MctsResult search(Game const& game);
+
+	// Grows the tree with no deadline nor playout limit while the
+	// opponent (the player to move) thinks, until the stop flag is set or
+	// the arena is three quarters full, so the next search starts from
+	// the subtree of their move. Returns their expected move.
+	Move ponder(Game const& game);
+private:
+	struct Node;
+	struct Worker;
+
+	void work(Game const& game, unsigned int thread);
+	void iterate(Worker& worker);
+	bool expand(Node& node, Game& game);
+	Node& select(Node const& node) const;
+	std::uint32_t playout(Worker& worker);
+	std::uint32_t allocate(std::uint32_t count);
+	std::uint32_t find(std::uint32_t n, std::uint64_t hash, int depth) const;
+	bool shouldStop() const;
+private:
+	MctsOptions m_options;
+	std::shared_ptr<Tablebase const> m_tablebase;
+	std::unique_ptr<Node[]> m_nodes;
+	std::atomic<std::uint32_t> m_used;
+	std::uint32_t m_root;
+	unsigned long long m_searches;
+	std::atomic<unsigned long long> m_playouts;
+	std::atomic<bool> m_stop;
+	std::atomic<bool> const* m_stop_flag;
+	bool m_pondering;
+	std::chrono::steady_clock::time_point m_deadline;
+};
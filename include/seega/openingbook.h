@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+#include "mappedfile.h"
+
+class Game;
+class RecordReader;
+struct Move;
+
+// Placement seen in the recorded games from one position
+struct BookMove
+{
+	int cell;
+	std::uint32_t games;
+	std::uint32_t points; // 2 per win and 1 per draw of the player placing
+};
+
+// Opening book for the placement stage: how each placement played from
+// each position fared in recorded games, read straight from a memory
+// mapped file shared by every thread. Positions are found by the
+// Zobrist hash of their canonical image under the board symmetries, so
+// placement orders reaching the same position, or a rotation or
+// reflection of it, share their statistics. Cells are kept in the
+// canonical frame and mapped back when chosen.
+//
+// The file holds the entries sorted by key, then cell, after a header:
+//   u32 magic, u32 version, u32 dimension, u32 zero, u64 entry count
+//   for each entry: u64 key, u8 cell, 3 zero bytes, u32 games, u32 points
+// so a position is found by binary search, in O(log n).
+class OpeningBook
+{
+public:
+	static constexpr unsigned int DEFAULT_MIN_GAMES = 16;
+public:
+	OpeningBook();
+
+	// Returns false if the file is missing or not a book, its entries
+	// included: they must be sorted, with no (key, cell) pair twice
+	bool open(std::string const& path);
+	bool isOpen() const;
+	int getDimension() const;
+	std::uint64_t getEntryCount() const;
+
+	// Entries played fewer times are ignored by chooseMove()
+	void setMinGames(unsigned int min_games);
+
+	// Fills moves with up to capacity placements known for the position
+	// and returns how many there are
+	int probe(std::uint64_t key, BookMove* moves, int capacity) const;
+
+	// Picks the known placement with the best share of points, smoothed
+	// so that a few lucky games do not win over many good ones. Returns
+	// false if the position is not in the book or is not a placement.
+	bool chooseMove(Game const& game, Move& move) const;
+
+	// Gathers the first max_plies placements of every game of the given
+	// size in the records and writes the ones played at least min_games
+	// times to path. Progress goes to log.
+	static bool build(RecordReader const& records, int dim, int max_plies,
+		unsigned int min_games, std::string const& path, std::ostream& log);
+private:
+	// Index of the first entry with a key not below key
+	std::uint64_t lowerBound(std::uint64_t key) const;
+private:
+	MappedFile m_file;
+	int m_dim;
+	std::uint64_t m_entries;
+	unsigned int m_min_games;
+};
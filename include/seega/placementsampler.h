@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "bitboard.h"
+
+enum class Cell;
+
+// Where the random AI places its pieces: any free cell but the central
+// one, with odds growing with the squared distance to the centroid of
+// the pieces of the player (to the middle of the board before the first
+// one). Placements keep, for each player, the sums of the coordinates of
+// its pieces, and a Fenwick tree keeps, over the free cells, their count
+// and the sums of i, j and i^2 + j^2. As the squared distance expands
+// into those sums, the weight of any run of cells follows in O(1), and a
+// cell is drawn in O(log n) with no pass over the board. Everything is in
+// integers, scaled by the piece count, so the odds are exact.
+class PlacementSampler
+{
+public:
+	explicit PlacementSampler(int dim);
+
+	// A piece of the player arrives at the free cell n, or leaves it
+	void place(int n, Cell player);
+	void unplace(int n, Cell player);
+
+	// Cell drawn for the player's next piece from u, uniform in [0, 1).
+	// free must hold the free cells, as placements left them.
+	int sample(Cell player, BitMask free, float u) const;
+	// The same over the cells of a board of any size, row after row, the
+	// free ones being the empty ones but the central one
+	int sample(Cell player, Cell const* cells, float u) const;
+private:
+	// Sums over a set of cells
+	struct Moments
+	{
+		std::int32_t count, i, j, squares;
+	};
+
+	void add(int n, int sign);
+	// First cell the draw may land on, if free
+	int findFirst(Cell player, float u) const;
+private:
+	int m_dim;
+	int m_top; // highest power of 2 not above the number of cells
+	std::vector<Moments> m_tree; // 1-based
+	int m_pieces[2];
+	int m_sum_i[2], m_sum_j[2];
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "game.h"
+
+class RecordView;
+
+// Rebuilds any position of a recorded game. Loading plays the game once
+// and keeps a copy of it every getInterval() plies, so seeking to a ply
+// replays at most getInterval() - 1 plies from the copy before it, or
+// fewer from the current position when that is closer.
+class Replay
+{
+public:
+	static constexpr int DEFAULT_INTERVAL = 16;
+public:
+	explicit Replay(int interval = DEFAULT_INTERVAL);
+
+	// Returns false, keeping the plies up to the illegal one, if the
+	// record does not follow the rules
+	bool load(RecordView const& view);
+	bool load(int dim, Cell first, std::vector<Move> const& moves);
+
+	int getInterval() const { return m_interval; }
+	int getPlyCount() const { return (int) m_moves.size(); }
+	Move getMove(int ply) const { return m_moves[ply]; }
+
+	// Position after the given number of plies (0 is the empty board),
+	// clamped to the game
+	Game const& seek(int ply);
+	Game const& getGame() const { return *m_game; }
+	int getPly() const { return m_ply; }
+private:
+	bool play(Game& game, Move move) const;
+private:
+	int m_interval;
+	std::vector<Move> m_moves;
+	std::vector<Game> m_snapshots; // after 0, K, 2K... plies
+	std::unique_ptr<Game> m_game;
+	int m_ply;
+};
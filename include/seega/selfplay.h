@@ -0,0 +1,68 @@
+#pragma once
+
+#include <memory>
+#include <random>
+#include <string>
+
+#include "agent.h"
+#include "gamerecord.h"
+#include "openingbook.h"
+
+class Game;
+enum class Cell;
+
+// Totals of a batch of AI-vs-AI games
+struct SelfPlayStats
+{
+	unsigned long long games = 0;
+	unsigned long long plies = 0;
+	unsigned long long yellow_wins = 0;
+	unsigned long long red_wins = 0;
+	unsigned long long draws = 0; // games cut at the ply limit
+	SearchStats search;
+
+	void record(Game const& game);
+	SelfPlayStats& operator+=(SelfPlayStats const& other);
+};
+
+struct SelfPlayOptions
+{
+	int board_size = 5;
+	unsigned int seed = 0;
+	unsigned long long games = 1;
+	int max_plies = 1000;
+	unsigned int threads = 1; // 0 = one per hardware core
+	// Names in the AgentRegistry of the agents playing yellow and red,
+	// which must be there
+	std::string agents[2] = { "aleatorio", "aleatorio" };
+	AgentOptions agent; // the endgame tables are shared by every game
+	std::shared_ptr<OpeningBook const> book; // shared by every game
+	std::shared_ptr<RecordWriter> record; // gets every game, if given
+};
+
+// Reseeds an engine for the n-th game of a run from the run seed alone,
+// so that any game can be reproduced no matter which thread played it
+void seedSelfPlayEngine(std::default_random_engine& rng, unsigned int seed,
+	unsigned long long n);
+
+// Agents a worker reuses from game to game, by player. Both players
+// have the same one when they are given the same name.
+struct SelfPlayEngines
+{
+	std::shared_ptr<Agent> agents[2];
+
+	// Nullptr for a name not in the registry
+	static SelfPlayEngines create(SelfPlayOptions const& options);
+};
+
+// Plays the n-th game of a run until it ends or hits the ply limit, and
+// returns the winner (Cell::EMPTY for a draw). Agents start the game from
+// scratch (empty table, no tree), seeded from the game, so that the
+// outcome does not depend on earlier games.
+Cell playSelfGame(SelfPlayOptions const& options, unsigned long long n,
+	std::default_random_engine& rng, SelfPlayEngines const& engines,
+	SelfPlayStats& stats);
+
+// Plays every game of a run, spread over the requested threads.
+// The totals only depend on the options, not on the thread count.
+SelfPlayStats runSelfPlay(SelfPlayOptions const& options);
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+#include "bitboard.h"
+
+enum class Cell;
+struct Move;
+
+// The 8 rotations and reflections of the square board (the dihedral
+// group D4). The rules treat every direction alike, so positions that
+// map onto each other have the same value and mirrored best moves. On
+// even boards the special center cell is off the middle, so only the
+// identity and the transposition, which keep it in place, are used there.
+//
+// Transform t transposes the board if t & 4, then mirrors the columns if
+// t & 1, then the rows if t & 2; 0 is the identity. Masks are moved with
+// a few shifts and delta swaps per row or diagonal, never cell by cell.
+namespace symmetry
+{
+	constexpr int COUNT = 8;
+
+	// Image of the cells of the mask under transform t
+	BitMask apply(BitMask mask, int t, int dim);
+
+	// All 8 images at once, sharing the transposition
+	void applyAll(BitMask mask, int dim, BitMask* images);
+
+	int mapCell(int n, int t, int dim);
+	Move mapMove(Move move, int t, int dim);
+	int inverse(int t);
+
+	// The image with the smallest masks among the 8 (2 on even boards),
+	// and the transform that leads to it from the given position
+	struct Canonical
+	{
+		BitMask yellow, red;
+		int transform;
+	};
+	Canonical canonicalize(BitMask yellow, BitMask red, int dim);
+
+	// Zobrist hash of the canonical image: equal for every symmetric copy
+	// of a position. Sets the transform into the canonical frame.
+	std::uint64_t canonicalHash(BitBoard const& bits, Cell turn, bool half_turn,
+		int& transform);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "bitboard.h"
+#include "mappedfile.h"
+
+class Game;
+struct Move;
+
+enum class TBResult
+{
+	DRAW,
+	WIN,
+	LOSS,
+};
+
+// Value of a movement stage position for the player to move
+struct TBEntry
+{
+	TBResult result;
+	// Plies to the end of the game with best play, 0 on draws, saturated
+	// at Tablebase::MAX_DISTANCE
+	int distance;
+};
+
+// Endgame tables: the exact value of every movement stage position with
+// up to getMaxPieces() pieces on the board, read straight from a memory
+// mapped file shared by every thread.
+//
+// The file holds one byte per position for each material class (count of
+// yellow and red pieces), after a small header:
+//   u32 magic, u32 version, u32 dimension, u32 max pieces,
+//   u64 offset of each class, ordered by yellow then red count.
+// A class is indexed by the combinatorial rank of the yellow cells, then
+// of the red cells among the cells left, then the color to move. A byte
+// is 0 for a draw, the distance to the win for a win, or 0x80 plus the
+// distance to the loss for a loss. Distances over MAX_DISTANCE plies
+// saturate, so an entry at MAX_DISTANCE may be further from the end.
+class Tablebase
+{
+public:
+	static constexpr int MAX_PIECES = 12;
+	static constexpr int MAX_DISTANCE = 0x7F;
+public:
+	Tablebase();
+
+	// Returns false if the file is missing or not a table
+	bool open(std::string const& path);
+	bool isOpen() const;
+	int getDimension() const;
+	int getMaxPieces() const;
+
+	// Looks the position up. Returns false if it is not covered: not in
+	// the movement stage, another board size or too many pieces.
+	bool probe(Game const& game, TBEntry& entry) const;
+
+	// Finds the move that keeps the best value: the fastest win, else a
+	// draw, else the slowest loss. Returns false if not covered, or if the
+	// distance saturated, as following it might never end the game.
+	bool chooseMove(Game& game, Move& move) const;
+
+	// Retrograde analysis of every class with up to max_pieces pieces,
+	// from the fewest pieces up, written to path. Progress goes to log.
+	static bool build(int dim, int max_pieces, std::string const& path,
+		std::ostream& log);
+private:
+	bool probe(BitMask yellow, BitMask red, Cell turn, TBEntry& entry) const;
+private:
+	MappedFile m_file;
+	int m_dim;
+	int m_max_pieces;
+	std::vector<std::uint64_t> m_offsets; // by class, see classIndex
+};
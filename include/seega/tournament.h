@@ -0,0 +1,100 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "agent.h"
+#include "openingbook.h"
+
+// Games of one agent against another, from the first one's side
+struct MatchScore
+{
+	unsigned long long wins = 0;
+	unsigned long long draws = 0; // games cut at the ply limit
+	unsigned long long losses = 0;
+	// pairs[h]: pairs of games worth h half points (0, 1/2, 1, 1 1/2, 2);
+	// both games of a pair share the opening, so a pair is one sample
+	unsigned long long pairs[5] = {};
+
+	unsigned long long getGames() const;
+	unsigned long long getPairs() const;
+	// Points per game, a win being 1 and a draw 1/2
+	double getScore() const;
+	// Variance of the points per game of one pair
+	double getVariance() const;
+
+	// Elo difference the score stands for, and the bounds of its 95%
+	// confidence interval (infinite when the score is 0 or 1)
+	double getElo() const;
+	void getEloInterval(double& low, double& high) const;
+
+	MatchScore& operator+=(MatchScore const& other);
+	MatchScore reversed() const; // from the other agent's side
+};
+
+// Expected score of a player rated elo points above the other, and back
+double eloToScore(double elo);
+double scoreToElo(double score);
+
+// Sequential probability ratio test of the first agent being elo1 points
+// stronger than the second (H1) against elo0 points (H0), with error rates
+// alpha (accepting H1 under H0) and beta (accepting H0 under H1)
+struct SprtOptions
+{
+	bool enabled = false;
+	double elo0 = 0.;
+	double elo1 = 10.;
+	double alpha = 0.05;
+	double beta = 0.05;
+};
+
+enum class SprtResult
+{
+	CONTINUE,
+	H0, // stronger by elo0 at most
+	H1, // stronger by elo1 at least
+};
+
+// Log-likelihood ratio of H1 against H0, with the score of a pair taken
+// as normal with the variance seen so far
+double sprtLlr(MatchScore const& score, SprtOptions const& sprt);
+SprtResult sprtTest(MatchScore const& score, SprtOptions const& sprt);
+
+struct TournamentOptions
+{
+	// Names in the AgentRegistry, which must be there, at least two
+	std::vector<std::string> agents;
+	int board_size = 5;
+	unsigned int seed = 0;
+	// Pairs of games of each pairing, the most under SPRT
+	unsigned long long pairs = 100;
+	int max_plies = 1000;
+	unsigned int threads = 1; // 0 = one per hardware core
+	AgentOptions agent;
+	std::shared_ptr<OpeningBook const> book; // shared by every game
+	// Stops a match of two agents once it decides; checked after every
+	// pair, in the order of the pairs, so the result does not depend on
+	// the thread count
+	SprtOptions sprt;
+};
+
+struct TournamentResult
+{
+	std::vector<std::string> agents;
+	// scores[a][b]: games of agent a against agent b, from a's side
+	std::vector<std::vector<MatchScore>> scores;
+	unsigned long long pairs = 0; // pairs played by each pairing
+	SprtResult sprt = SprtResult::CONTINUE;
+	double llr = 0.;
+
+	// Games of agent a against all the others
+	MatchScore getTotal(std::size_t a) const;
+};
+
+// Round robin: every agent plays every other one the given number of
+// pairs of games. Both games of a pair start from the same seed, with
+// the colors swapped, so that neither agent gets the better openings or
+// the first move more often; the n-th pair has the same seed in every
+// pairing. Games are spread over the threads, each with its own agents.
+TournamentResult runTournament(TournamentOptions const& options);
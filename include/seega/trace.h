@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+
+// Timing of the game rules and of the robots, compiled in only with the
+// SEEGA_TRACE definition (cmake -DSEEGA_TRACE=ON); otherwise the trace
+// macros expand to nothing. Each thread records into its own buffers,
+// without locks: the last RING_SIZE calls in a ring, for a Chrome trace
+// (chrome://tracing or ui.perfetto.dev), and every call in a histogram of
+// durations per point. At exit the trace goes to the file named by the
+// SEEGA_TRACE_FILE environment variable (seega_trace.json by default) and
+// the histograms to the standard error.
+namespace trace
+{
+	enum class Point : std::uint8_t
+	{
+		PLACE_PIECE,       // Game::placePiecePrivate
+		MOVE_PIECE,        // Game::movePiecePrivate
+		PROCESS_MOVE,      // Game::processMove, also inside the searches
+		HAS_POSSIBLE_MOVE, // Game::hasPossibleMove, likewise
+		CHOOSE_PLACEMENT,  // Game::chooseAiMove, placing stage
+		CHOOSE_MOVE,       // Game::chooseAiMove, playing stage
+		COUNT
+	};
+
+	constexpr unsigned int RING_SIZE = 1 << 15;
+
+	char const* getName(Point point);
+
+#if defined(SEEGA_TRACE)
+	// Nanoseconds since the first call
+	std::uint64_t now();
+	void record(Point point, std::uint64_t start, std::uint64_t end);
+
+	// What is written at exit, for writing it sooner. Threads must not
+	// record meanwhile.
+	void writeChromeTrace(std::ostream& out);
+	void writeSummary(std::ostream& out);
+
+	// Records the time from its construction to the end of the scope
+	class Scope
+	{
+	public:
+		explicit Scope(Point point) :
+			m_point(point), m_start(now())
+		{
+		}
+		~Scope() { record(m_point, m_start, now()); }
+
+		Scope(Scope const&) = delete;
+		Scope& operator=(Scope const&) = delete;
+	private:
+		Point m_point;
+		std::uint64_t m_start;
+	};
+#endif
+}
+
+#if defined(SEEGA_TRACE)
+#define SEEGA_TRACE_CONCAT_(a, b) a##b
+#define SEEGA_TRACE_CONCAT(a, b) SEEGA_TRACE_CONCAT_(a, b)
+#define SEEGA_TRACE_SCOPE(point) \
+	trace::Scope SEEGA_TRACE_CONCAT(seega_trace_scope_, __LINE__)(point)
+#else
+#define SEEGA_TRACE_SCOPE(point) ((void) 0)
+#endif
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "game.h"
+
+enum class Bound : std::uint8_t
+{
+	EXACT,
+	LOWER, // fail high, score is a lower bound
+	UPPER, // fail low, score is an upper bound
+};
+
+struct TTEntry
+{
+	int score;
+	int depth;
+	Bound bound;
+	bool has_move;
+	Move move;
+};
+
+enum class TTProbe
+{
+	EMPTY,     // slot never written
+	COLLISION, // slot holds another position
+	HIT,
+};
+
+// Fixed-size transposition table that any number of search threads can
+// read and write without locks. Each slot keeps the entry and the entry
+// XOR the position key in two atomic words; a slot torn by concurrent
+// writers simply fails verification and reads as a collision.
+class TranspositionTable
+{
+public:
+	explicit TranspositionTable(std::size_t megabytes);
+
+	std::size_t getSize() const; // in slots
+	void clear();
+
+	// Ages older entries so they are replaced first
+	void newSearch();
+
+	TTProbe probe(std::uint64_t key, TTEntry& entry) const;
+	void store(std::uint64_t key, TTEntry const& entry);
+
+	// Permille of slots written during the current search (sampled)
+	int hashfull() const;
+private:
+	struct Slot
+	{
+		std::atomic<std::uint64_t> check; // key ^ data
+		std::atomic<std::uint64_t> data;
+	};
+
+	static std::uint64_t pack(TTEntry const& entry, std::uint8_t generation);
+	static TTEntry unpack(std::uint64_t data);
+	static std::uint8_t generation(std::uint64_t data);
+	static int depth(std::uint64_t data);
+private:
+	std::unique_ptr<Slot[]> m_slots;
+	std::size_t m_mask;
+	std::uint8_t m_generation;
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Runs f(worker, n) for every n in [0, count) over a fixed set of threads.
+// Each worker starts with an even slice of the range and, once it runs
+// dry, steals the upper half of the largest slice left to another worker,
+// so uneven task lengths never leave a core idle while work remains.
+// Slices live in one atomic word per worker, so there are no locks.
+class WorkStealingRunner
+{
+public:
+	// 0 threads means one per hardware core
+	explicit WorkStealingRunner(unsigned int threads = 0) :
+		m_threads(threads ? threads : std::thread::hardware_concurrency())
+	{
+		if (m_threads == 0)
+			m_threads = 1;
+	}
+
+	unsigned int getThreadCount() const { return m_threads; }
+
+	template<class F>
+	void run(unsigned long long count, F f);
+private:
+	// Slice [begin, end) packed as begin << 32 | end
+	struct alignas(64) Slot
+	{
+		std::atomic<std::uint64_t> range;
+	};
+
+	static std::uint64_t pack(std::uint32_t begin, std::uint32_t end)
+	{
+		return (std::uint64_t(begin) << 32) | end;
+	}
+
+	static std::uint32_t begin(std::uint64_t range) { return (std::uint32_t) (range >> 32); }
+	static std::uint32_t end(std::uint64_t range) { return (std::uint32_t) range; }
+
+	static bool take(Slot& slot, std::uint32_t& n);
+	static bool steal(Slot* slots, unsigned int count, unsigned int thief);
+private:
+	unsigned int m_threads;
+};
+
+inline bool WorkStealingRunner::take(Slot& slot, std::uint32_t& n)
+{
+	std::uint64_t range = slot.range.load(std::memory_order_acquire);
+	while (begin(range) < end(range)) {
+		if (slot.range.compare_exchange_weak(range,
+			pack(begin(range) + 1, end(range)),
+			std::memory_order_acq_rel)) {
+			n = begin(range);
+			return true;
+		}
+	}
+	return false;
+}
+
+inline bool WorkStealingRunner::steal(Slot* slots, unsigned int count,
+	unsigned int thief)
+{
+	for (;;) {
+		unsigned int victim = count;
+		std::uint64_t victim_range = 0;
+		std::uint32_t largest = 0;
+		for (unsigned int w = 0; w < count; ++w) {
+			if (w == thief)
+				continue;
+			std::uint64_t range = slots[w].range.load(std::memory_order_acquire);
+			if (begin(range) < end(range) && end(range) - begin(range) > largest) {
+				largest = end(range) - begin(range);
+				victim = w;
+				victim_range = range;
+			}
+		}
+		if (victim == count)
+			return false; // Nothing left anywhere
+		const std::uint32_t b = begin(victim_range), e = end(victim_range);
+		const std::uint32_t mid = b + (e - b) / 2;
+		if (slots[victim].range.compare_exchange_strong(victim_range,
+			pack(b, mid), std::memory_order_acq_rel)) {
+			slots[thief].range.store(pack(mid, e), std::memory_order_release);
+			return true;
+		}
+	}
+}
+
+template<class F>
+void WorkStealingRunner::run(unsigned long long count, F f)
+{
+	// Slices hold 32-bit indices, so huge runs go in batches
+	const unsigned long long batch_size = 0xFFFFFFFFull;
+	std::unique_ptr<Slot[]> slots(new Slot[m_threads]);
+	for (unsigned long long base = 0; base < count; base += batch_size) {
+		const unsigned long long batch = std::min(count - base, batch_size);
+		for (unsigned int w = 0; w < m_threads; ++w)
+			slots[w].range.store(pack(
+				(std::uint32_t) (batch * w / m_threads),
+				(std::uint32_t) (batch * (w + 1) / m_threads)));
+		auto work = [&](unsigned int w) {
+			std::uint32_t n;
+			do {
+				while (take(slots[w], n))
+					f(w, base + n);
+			} while (steal(slots.get(), m_threads, w));
+		};
+		std::vector<std::thread> threads;
+		for (unsigned int w = 1; w < m_threads; ++w)
+			threads.emplace_back(work, w);
+		work(0);
+		for (auto& thread : threads)
+			thread.join();
+	}
+}
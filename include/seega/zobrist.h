@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+class BitBoard;
+struct BitMask;
+enum class Cell;
+
+// Random keys for incremental position hashing. A position hashes to
+// the XOR of the keys of its pieces, of the side to move when it is
+// red, and of the placement half-turn when one piece is left to place.
+namespace zobrist
+{
+	std::uint64_t cell(int n, Cell cell);
+	std::uint64_t redTurn();
+	std::uint64_t halfTurn();
+
+	// Hash computed from scratch, for checking the incremental one
+	std::uint64_t hash(BitBoard const& bits, Cell turn, bool half_turn);
+	// The same for the pieces given, for a board not built
+	std::uint64_t hash(BitMask yellow, BitMask red, Cell turn, bool half_turn);
+}
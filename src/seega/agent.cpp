@@ -0,0 +1,272 @@
+#include "agent.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "board.h"
+#include "game.h"
+
+Agent::~Agent()
+{
+}
+
+bool Agent::ponder(Game const&)
+{
+	return false;
+}
+
+void Agent::setStopFlag(std::atomic<bool> const*)
+{
+}
+
+void Agent::newGame(std::default_random_engine&)
+{
+}
+
+SearchStats Agent::getSearchTotals() const
+{
+	return SearchStats();
+}
+
+bool RandomAgent::chooseMove(Game const& game, std::default_random_engine& rng,
+	Move& move)
+{
+	if (game.isLarge())
+		return chooseOnBoard(game, rng, move);
+	BitBoard const& bits = game.getBits();
+	const Cell turn = game.getTurn();
+	switch (game.getStage()) {
+	case Game::Stage::PLACING_PIECES: {
+		const BitMask free = bits.empty() & ~bits.center();
+		const float u = std::uniform_real_distribution<float>()(rng);
+		const int n = game.m_placement.sample(turn, free, u);
+		move = Move{ (std::uint16_t) n, (std::uint16_t) n };
+		return true;
+	}
+	case Game::Stage::PLAYING: {
+		Move moves[Game::MAX_MOVES];
+		int count = 0;
+		bits.forEachMove(turn, [&](int from, int to) {
+			moves[count++] = Move{ (std::uint16_t) from, (std::uint16_t) to };
+		});
+		if (count == 0)
+			return false;
+		const BitMask capture_targets = bits.captureTargets(turn);
+		for (int i = 0; i < count; ++i)
+			if (capture_targets.test(moves[i].to)) {
+				move = moves[i];
+				return true;
+			}
+		std::sample(moves, moves + count, &move, 1, rng);
+		return true;
+	}
+	default:
+		return false;
+	}
+}
+
+bool RandomAgent::chooseOnBoard(Game const& game, std::default_random_engine& rng,
+	Move& move) const
+{
+	Board const& board = *game.getBoard();
+	const int dim = board.getDimension();
+	const Cell turn = game.getTurn();
+	switch (game.getStage()) {
+	case Game::Stage::PLACING_PIECES: {
+		const float u = std::uniform_real_distribution<float>()(rng);
+		const int n = game.m_placement.sample(turn, board[0], u);
+		move = Move{ (std::uint16_t) n, (std::uint16_t) n };
+		return true;
+	}
+	case Game::Stage::PLAYING: {
+		// In the order of BitBoard::forEachMove
+		static const int STEPS[4][2] = { { -1, 0 }, { 0, -1 }, { 1, 0 }, { 0, 1 } };
+		std::vector<Move> moves;
+		for (int i = 0; i < dim; ++i)
+			for (int j = 0; j < dim; ++j) {
+				if (board[i][j] != Cell::EMPTY)
+					continue;
+				for (auto const& step : STEPS) {
+					const int i_from = i + step[0], j_from = j + step[1];
+					if (i_from >= 0 && i_from < dim && j_from >= 0 && j_from < dim &&
+						board[i_from][j_from] == turn)
+						moves.push_back(Move{ (std::uint16_t) (i_from * dim + j_from),
+							(std::uint16_t) (i * dim + j) });
+				}
+			}
+		if (moves.empty())
+			return false;
+		for (Move const& candidate : moves) {
+			int captured[4];
+			if (game.boardCaptures(candidate.to / dim, candidate.to % dim, turn, captured) > 0) {
+				move = candidate;
+				return true;
+			}
+		}
+		std::sample(moves.begin(), moves.end(), &move, 1, rng);
+		return true;
+	}
+	default:
+		return false;
+	}
+}
+
+SearchAgent::SearchAgent(std::shared_ptr<AlphaBeta> search) :
+	m_search(search)
+{
+}
+
+std::shared_ptr<AlphaBeta> SearchAgent::getSearch() const
+{
+	return m_search;
+}
+
+bool SearchAgent::chooseMove(Game const& game, std::default_random_engine& rng,
+	Move& move)
+{
+	if (game.getStage() != Game::Stage::PLAYING ||
+		!game.getBits().hasMove(game.getTurn()))
+		return m_placement.chooseMove(game, rng, move);
+	move = m_search->search(game).move;
+	return true;
+}
+
+bool SearchAgent::ponder(Game const& game)
+{
+	if (game.getStage() != Game::Stage::PLAYING)
+		return false;
+	m_search->ponder(game);
+	return true;
+}
+
+void SearchAgent::setStopFlag(std::atomic<bool> const* stop)
+{
+	m_search->setStopFlag(stop);
+}
+
+void SearchAgent::newGame(std::default_random_engine&)
+{
+	if (m_search->getTable())
+		m_search->getTable()->clear();
+}
+
+SearchStats SearchAgent::getSearchTotals() const
+{
+	return m_search->getTotals();
+}
+
+MctsAgent::MctsAgent(std::shared_ptr<Mcts> mcts) :
+	m_mcts(mcts)
+{
+}
+
+std::shared_ptr<Mcts> MctsAgent::getMcts() const
+{
+	return m_mcts;
+}
+
+bool MctsAgent::chooseMove(Game const& game, std::default_random_engine&,
+	Move& move)
+{
+	Move moves[Game::MAX_MOVES];
+	if (game.isOver() || game.getLegalMoves(moves) == 0)
+		return false;
+	move = m_mcts->search(game).move;
+	return true;
+}
+
+bool MctsAgent::ponder(Game const& game)
+{
+	m_mcts->ponder(game);
+	return true;
+}
+
+void MctsAgent::setStopFlag(std::atomic<bool> const* stop)
+{
+	m_mcts->setStopFlag(stop);
+}
+
+void MctsAgent::newGame(std::default_random_engine& rng)
+{
+	m_mcts->reset(rng());
+}
+
+AgentRegistry& AgentRegistry::instance()
+{
+	static AgentRegistry registry;
+	return registry;
+}
+
+AgentRegistry::AgentRegistry()
+{
+	add("aleatorio", "captura quando pode e joga ao acaso",
+		[](AgentOptions const&) {
+			return std::make_shared<RandomAgent>();
+		});
+	add("alfabeta", "busca alfa-beta no movimento",
+		[](AgentOptions const& options) {
+			auto search = std::make_shared<AlphaBeta>(options.search);
+			search->setTablebase(options.tablebase);
+			return std::make_shared<SearchAgent>(search);
+		});
+	add("mcts", "busca Monte Carlo na colocacao e no movimento",
+		[](AgentOptions const& options) {
+			auto mcts = std::make_shared<Mcts>(options.mcts);
+			mcts->setTablebase(options.tablebase);
+			return std::make_shared<MctsAgent>(mcts);
+		});
+}
+
+bool AgentRegistry::add(std::string const& name, std::string const& description,
+	Factory factory)
+{
+	if (find(name))
+		return false;
+	m_entries.push_back(Entry{ name, description, factory });
+	return true;
+}
+
+std::shared_ptr<Agent> AgentRegistry::create(std::string const& name,
+	AgentOptions const& options) const
+{
+	Entry const* entry = find(name);
+	return entry ? entry->factory(options) : nullptr;
+}
+
+bool AgentRegistry::contains(std::string const& name) const
+{
+	return find(name) != nullptr;
+}
+
+std::vector<std::string> AgentRegistry::getNames() const
+{
+	std::vector<std::string> names;
+	for (Entry const& entry : m_entries)
+		names.push_back(entry.name);
+	return names;
+}
+
+std::string AgentRegistry::getDescription(std::string const& name) const
+{
+	Entry const* entry = find(name);
+	return entry ? entry->description : std::string();
+}
+
+std::string AgentRegistry::listNames() const
+{
+	std::string list;
+	for (std::size_t k = 0; k < m_entries.size(); ++k) {
+		if (k > 0)
+			list += k + 1 == m_entries.size() ? " ou " : ", ";
+		list += m_entries[k].name;
+	}
+	return list;
+}
+
+AgentRegistry::Entry const* AgentRegistry::find(std::string const& name) const
+{
+	for (Entry const& entry : m_entries)
+		if (entry.name == name)
+			return &entry;
+	return nullptr;
+}
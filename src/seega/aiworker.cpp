@@ -0,0 +1,111 @@
+#include "aiworker.h"
+
+AiWorker::AiWorker(unsigned int seed) :
+	m_job_ponders(false),
+	m_generation(0),
+	m_busy(false),
+	m_has_result(false),
+	m_found(false),
+	m_result{ 0, 0 },
+	m_quit(false),
+	m_stop(false),
+	m_rng(seed),
+	m_thread(&AiWorker::run, this)
+{
+}
+
+AiWorker::~AiWorker()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+		m_stop.store(true);
+	}
+	m_wake.notify_one();
+	m_thread.join();
+}
+
+void AiWorker::start(Game const& game)
+{
+	post(game, false);
+}
+
+void AiWorker::ponder(Game const& game)
+{
+	post(game, true);
+}
+
+void AiWorker::post(Game const& game, bool ponders)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		++m_generation;
+		m_stop.store(true); // the job in progress, if any
+		m_job = std::make_unique<Game>(game);
+		m_job_ponders = ponders;
+		m_busy = !ponders;
+		m_has_result = false;
+	}
+	m_wake.notify_one();
+}
+
+bool AiWorker::poll(Move& move)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_has_result)
+		return false;
+	m_has_result = false;
+	m_busy = false;
+	move = m_result;
+	return m_found;
+}
+
+bool AiWorker::isBusy() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_busy;
+}
+
+void AiWorker::cancel()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	++m_generation;
+	m_stop.store(true);
+	m_job.reset();
+	m_busy = false;
+	m_has_result = false;
+}
+
+void AiWorker::run()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;) {
+		m_wake.wait(lock, [this] { return m_quit || m_job; });
+		if (m_quit)
+			return;
+		std::unique_ptr<Game> game = std::move(m_job);
+		const bool ponders = m_job_ponders;
+		const std::uint64_t generation = m_generation;
+		m_stop.store(false);
+		// Else every copy would repeat the random choices of the first
+		game->reseed((unsigned int) m_rng());
+		lock.unlock();
+
+		game->setVerbose(false);
+		game->setStopFlag(&m_stop);
+		Move move{ 0, 0 };
+		bool found = false;
+		if (ponders)
+			game->ponder();
+		else
+			found = game->chooseAiMove(move);
+		game->setStopFlag(nullptr);
+
+		lock.lock();
+		if (!ponders && generation == m_generation) {
+			m_result = move;
+			m_found = found;
+			m_has_result = true;
+		}
+	}
+}
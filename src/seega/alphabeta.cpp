@@ -0,0 +1,454 @@
+#include "alphabeta.h"
+
+#include <algorithm>
+#include <cassert>
+#include <thread>
+
+#include "board.h"
+#include "symmetry.h"
+
+namespace
+{
+	// Calls of negamax and searchLeaves between two looks at the clock
+	constexpr unsigned int CHECK_PERIOD = 256;
+
+	// Win scores are relative to the root; the table keeps them relative
+	// to the node, so that they stay right when reached from another ply
+	int toTable(int score, int ply)
+	{
+		if (score >= AlphaBeta::WIN_SCORE - AlphaBeta::MAX_PLY)
+			return score + ply;
+		if (score <= -AlphaBeta::WIN_SCORE + AlphaBeta::MAX_PLY)
+			return score - ply;
+		return score;
+	}
+
+	int fromTable(int score, int ply)
+	{
+		if (score >= AlphaBeta::WIN_SCORE - AlphaBeta::MAX_PLY)
+			return score - ply;
+		if (score <= -AlphaBeta::WIN_SCORE + AlphaBeta::MAX_PLY)
+			return score + ply;
+		return score;
+	}
+
+	// Moves the given move to the front, if it is in the list
+	void promote(Move* moves, int count, Move move)
+	{
+		for (int i = 0; i < count; ++i)
+			if (moves[i].from == move.from && moves[i].to == move.to) {
+				std::rotate(moves, moves + i, moves + i + 1);
+				return;
+			}
+	}
+}
+
+SearchStats& SearchStats::operator+=(SearchStats const& other)
+{
+	nodes += other.nodes;
+	tt_probes += other.tt_probes;
+	tt_hits += other.tt_hits;
+	tt_collisions += other.tt_collisions;
+	tb_hits += other.tb_hits;
+	return *this;
+}
+
+AlphaBeta::AlphaBeta(SearchOptions const& options,
+	std::shared_ptr<TranspositionTable> tt) :
+	m_options(options),
+	m_tt(tt),
+	m_stop_flag(nullptr),
+	m_pondering(false),
+	m_stopped(false),
+	m_calls(0),
+	m_index(0),
+	m_helpers_stop(false)
+{
+	assert(options.max_depth > 0);
+	m_options.max_depth = std::min(options.max_depth, MAX_PLY);
+	if (m_options.threads == 0)
+		m_options.threads = std::max(1u, std::thread::hardware_concurrency());
+	if (!m_tt && options.hash_mb > 0)
+		m_tt = std::make_shared<TranspositionTable>(options.hash_mb);
+	for (unsigned int h = 1; h < m_options.threads; ++h)
+		m_helpers.push_back(std::unique_ptr<AlphaBeta>(new AlphaBeta(*this, h)));
+}
+
+AlphaBeta::AlphaBeta(AlphaBeta const& main, unsigned int index) :
+	m_options(main.m_options),
+	m_tt(main.m_tt),
+	m_stop_flag(&main.m_helpers_stop),
+	m_pondering(false),
+	m_stopped(false),
+	m_calls(0),
+	m_index(index),
+	m_helpers_stop(false)
+{
+	m_options.threads = 1;
+	m_options.time_ms = 0; // Stopped by the main thread only
+}
+
+SearchOptions const& AlphaBeta::getOptions() const
+{
+	return m_options;
+}
+
+std::shared_ptr<TranspositionTable> AlphaBeta::getTable() const
+{
+	return m_tt;
+}
+
+SearchStats const& AlphaBeta::getTotals() const
+{
+	return m_totals;
+}
+
+void AlphaBeta::setTablebase(std::shared_ptr<Tablebase const> tablebase)
+{
+	m_tablebase = tablebase;
+}
+
+void AlphaBeta::setStopFlag(std::atomic<bool> const* stop)
+{
+	m_stop_flag = stop;
+}
+
+SearchResult AlphaBeta::search(Game const& game)
+{
+	if (m_tt)
+		m_tt->newSearch();
+
+	m_helpers_stop.store(false);
+	std::vector<SearchResult> helper_results(m_helpers.size());
+	std::vector<std::thread> threads;
+	for (std::size_t h = 0; h < m_helpers.size(); ++h) {
+		m_helpers[h]->m_tablebase = m_tablebase;
+		threads.emplace_back([this, &game, &helper_results, h]() {
+			helper_results[h] = m_helpers[h]->searchRoot(game);
+		});
+	}
+	SearchResult result = searchRoot(game);
+	m_helpers_stop.store(true);
+	for (auto& thread : threads)
+		thread.join();
+
+	for (SearchResult const& helper : helper_results) {
+		if (helper.depth > result.depth) {
+			result.move = helper.move;
+			result.score = helper.score;
+			result.depth = helper.depth;
+		}
+		result.stats += helper.stats;
+	}
+	m_totals += result.stats;
+	return result;
+}
+
+SearchResult AlphaBeta::searchRoot(Game const& game)
+{
+	m_stats = SearchStats();
+	m_stopped = false;
+	m_deadline = std::chrono::steady_clock::now() +
+		std::chrono::milliseconds(m_options.time_ms);
+
+	// Walked in place with make/unmake
+	Game root(game);
+
+	Move moves[MAX_MOVES];
+	const int count = generateMoves(root, moves);
+	assert(count > 0);
+
+	int transform;
+	const std::uint64_t key = tableKey(root, transform);
+	const int dim = root.getBits().getDimension();
+	TTEntry entry;
+	if (probe(key, entry) && entry.has_move)
+		promote(moves, count, symmetry::mapMove(entry.move, symmetry::inverse(transform), dim));
+
+	SearchResult result{ moves[0], 0, 0, m_stats };
+	if (count == 1)
+		return result; // Nothing to think about
+
+	// Helpers spread over the tree by starting from other moves, and half
+	// of them by searching each depth before the main thread gets to it
+	if (m_index > 0)
+		std::rotate(moves, moves + m_index % count, moves + count);
+	for (int depth = 1 + (m_index & 1); depth <= m_options.max_depth; ++depth) {
+		int alpha = -WIN_SCORE - 1;
+		int best = 0;
+		for (int i = 0; i < count; ++i) {
+			int score = searchChild(root, moves[i], depth - 1,
+				alpha, WIN_SCORE + 1, 1);
+			if (m_stopped)
+				break;
+			if (score > alpha) {
+				alpha = score;
+				best = i;
+			}
+		}
+		if (m_stopped)
+			break;
+		result.move = moves[best];
+		result.score = alpha;
+		result.depth = depth;
+		if (m_tt)
+			m_tt->store(key, TTEntry{ toTable(alpha, 0), depth, Bound::EXACT, true,
+				symmetry::mapMove(moves[best], transform, dim) });
+
+		// Best move leads the next iteration
+		std::rotate(moves, moves + best, moves + best + 1);
+
+		if (std::abs(alpha) >= WIN_SCORE - MAX_PLY)
+			break; // Forced win or loss found
+	}
+	result.stats = m_stats;
+	return result;
+}
+
+Move AlphaBeta::ponder(Game const& game)
+{
+	m_pondering = true;
+	const Move move = search(game).move;
+	m_pondering = false;
+	return move;
+}
+
+int AlphaBeta::negamax(Game& game, int depth, int alpha, int beta, int ply)
+{
+	++m_stats.nodes;
+	if (shouldStop())
+		return 0;
+	if (game.isOver())
+		return WIN_SCORE - ply; // The winner keeps the turn
+	int tb_score;
+	if (probeTablebase(game, ply, tb_score))
+		return tb_score;
+	if (depth == 0 || ply >= MAX_PLY)
+		return evaluate(game);
+
+	int transform;
+	const std::uint64_t key = tableKey(game, transform);
+	const int dim = game.getBits().getDimension();
+	TTEntry entry;
+	const bool hit = probe(key, entry);
+	if (hit && entry.depth >= depth) {
+		const int score = fromTable(entry.score, ply);
+		if (entry.bound == Bound::EXACT ||
+			(entry.bound == Bound::LOWER && score >= beta) ||
+			(entry.bound == Bound::UPPER && score <= alpha))
+			return score;
+	}
+
+	Move moves[MAX_MOVES];
+	const int count = generateMoves(game, moves);
+	if (count == 0)
+		return 0;
+	if (hit && entry.has_move)
+		promote(moves, count, symmetry::mapMove(entry.move, symmetry::inverse(transform), dim));
+
+	const int alpha_ini = alpha;
+	int best = -WIN_SCORE - 1;
+	Move best_move = moves[0];
+	if (depth == 1) {
+		best = searchLeaves(game, moves, count, alpha, beta, ply + 1, best_move);
+		if (m_stopped)
+			return 0;
+	} else {
+		for (int i = 0; i < count; ++i) {
+			int score = searchChild(game, moves[i], depth - 1, alpha, beta, ply + 1);
+			if (m_stopped)
+				return 0;
+			if (score > best) {
+				best = score;
+				best_move = moves[i];
+				if (score > alpha) {
+					alpha = score;
+					if (alpha >= beta)
+						break;
+				}
+			}
+		}
+	}
+	if (m_tt) {
+		const Bound bound = best <= alpha_ini ? Bound::UPPER
+			: best >= beta ? Bound::LOWER : Bound::EXACT;
+		m_tt->store(key, TTEntry{ toTable(best, ply), depth, bound, true,
+			symmetry::mapMove(best_move, transform, dim) });
+	}
+	return best;
+}
+
+int AlphaBeta::searchChild(Game& game, Move move, int depth,
+	int alpha, int beta, int ply)
+{
+	Game::Undo undo;
+	game.makeMove(move, undo);
+	// A player whose opponent is left without moves plays again
+	const int score = game.m_turn == undo.turn
+		? negamax(game, depth, alpha, beta, ply)
+		: -negamax(game, depth, -beta, -alpha, ply);
+	game.unmakeMove(undo);
+	return score;
+}
+
+int AlphaBeta::searchLeaves(Game& game, Move const* moves, int count,
+	int alpha, int beta, int ply, Move& best_move)
+{
+	// The children are scored a block at a time and then taken in order
+	// as negamax would, so the result is the same as searching them one
+	// by one. Blocks double from a single child, since the first moves
+	// (the one from the table and the captures) often cut off the rest.
+	if (shouldStop())
+		return 0;
+	int scores[EvalBatch::SIZE];
+	int lanes[EvalBatch::SIZE]; // child of each lane of the batch
+	const int dim = game.m_bits.getDimension();
+	if (!m_batch || m_batch->geometry.dim != dim)
+		m_batch = std::make_unique<EvalBatch>(dim);
+	const Cell me = game.m_turn;
+	const Cell enemy = game.getEnemy(me);
+	const bool tablebase = m_tablebase &&
+		game.m_yellow_pieces + game.m_red_pieces <= m_tablebase->getMaxPieces() + 3;
+
+	int best = -WIN_SCORE - 1;
+	int block = LEAF_BLOCK;
+	for (int first = 0; first < count;
+		first += block, block = std::min(2 * block, (int) EvalBatch::SIZE)) {
+		const int last = std::min(count, first + block);
+		m_batch->clear();
+		for (int i = first; i < last; ++i) {
+			++m_stats.nodes;
+			const int c = i - first;
+			if (tablebase) {
+				// Close to the tables: played out, as any leaf could be in them
+				Game::Undo undo;
+				game.makeMove(moves[i], undo);
+				// A player whose opponent is left without moves plays again
+				const int sign = game.m_turn == undo.turn ? 1 : -1;
+				int score;
+				if (game.isOver())
+					scores[c] = WIN_SCORE - ply;
+				else if (probeTablebase(game, ply, score))
+					scores[c] = sign * score;
+				else
+					lanes[m_batch->add(game.m_bits, me)] = c;
+				game.unmakeMove(undo);
+				continue;
+			}
+			// Only the pieces are needed, and the score of a leaf is the
+			// same whoever moves next, so there is nothing to make/unmake
+			BitBoard const& bits = game.m_bits;
+			const BitMask own = bits.pieces(me)
+				^ BitMask::bit(moves[i].from) ^ BitMask::bit(moves[i].to);
+			const BitMask enemies = bits.pieces(enemy)
+				& ~bits.captures(moves[i].to, own, bits.pieces(enemy));
+			if (!enemies.any())
+				scores[c] = WIN_SCORE - ply; // The winner keeps the turn
+			else
+				lanes[m_batch->add(own, enemies)] = c;
+		}
+		m_evaluator.evaluate(*m_batch);
+		for (int k = 0; k < m_batch->count; ++k)
+			scores[lanes[k]] = m_batch->score[k];
+
+		for (int i = first; i < last; ++i) {
+			if (scores[i - first] > best) {
+				best = scores[i - first];
+				best_move = moves[i];
+				if (best > alpha) {
+					alpha = best;
+					if (alpha >= beta)
+						return best;
+				}
+			}
+		}
+	}
+	return best;
+}
+
+int AlphaBeta::generateMoves(Game const& game, Move* moves) const
+{
+	const BitMask targets = game.m_bits.captureTargets(game.m_turn);
+	int count = 0, captures = 0;
+	game.m_bits.forEachMove(game.m_turn, [&](int from, int to) {
+		moves[count] = Move{ (std::uint8_t) from, (std::uint8_t) to };
+		if (targets.test(to))
+			std::swap(moves[captures++], moves[count]);
+		++count;
+	});
+	return count;
+}
+
+std::uint64_t AlphaBeta::tableKey(Game const& game, int& transform) const
+{
+	if (m_options.symmetry)
+		return game.getCanonicalHash(transform);
+	transform = 0;
+	return game.getHash();
+}
+
+bool AlphaBeta::probe(std::uint64_t key, TTEntry& entry)
+{
+	if (!m_tt)
+		return false;
+	++m_stats.tt_probes;
+	switch (m_tt->probe(key, entry)) {
+	case TTProbe::HIT:
+		++m_stats.tt_hits;
+		return true;
+	case TTProbe::COLLISION:
+		++m_stats.tt_collisions;
+		return false;
+	default:
+		return false;
+	}
+}
+
+bool AlphaBeta::probeTablebase(Game const& game, int ply, int& score)
+{
+	if (!m_tablebase ||
+		game.m_yellow_pieces + game.m_red_pieces > m_tablebase->getMaxPieces())
+		return false;
+	TBEntry entry;
+	if (!m_tablebase->probe(game, entry))
+		return false;
+	++m_stats.tb_hits;
+	// Long distances would fall below the win threshold; clamped to it,
+	// they still count as forced wins and losses
+	if (entry.result == TBResult::WIN)
+		score = std::max(WIN_SCORE - ply - entry.distance, WIN_SCORE - MAX_PLY);
+	else if (entry.result == TBResult::LOSS)
+		score = std::min(-WIN_SCORE + ply + entry.distance, -WIN_SCORE + MAX_PLY);
+	else
+		score = 0;
+	return true;
+}
+
+int AlphaBeta::evaluate(Game const& game) const
+{
+	const Cell me = game.m_turn;
+	const Cell enemy = game.getEnemy(me);
+	const int material = me == Cell::YELLOW
+		? game.m_yellow_pieces - game.m_red_pieces
+		: game.m_red_pieces - game.m_yellow_pieces;
+	const int mobility = game.m_bits.frontier(me).count()
+		- game.m_bits.frontier(enemy).count();
+	return 100 * material + mobility;
+}
+
+bool AlphaBeta::shouldStop()
+{
+	// Every call counts the same, whether it goes on to leaves, the
+	// tables or a whole subtree, so the clock is looked at steadily
+	if (!m_stopped && ++m_calls % CHECK_PERIOD == 0 && outOfTime())
+		m_stopped = true;
+	return m_stopped;
+}
+
+bool AlphaBeta::outOfTime()
+{
+	if (m_stop_flag && m_stop_flag->load(std::memory_order_relaxed))
+		return true;
+	return !m_pondering && m_options.time_ms != 0 &&
+		std::chrono::steady_clock::now() >= m_deadline;
+}
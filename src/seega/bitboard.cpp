@@ -0,0 +1,154 @@
+#include "bitboard.h"
+
+#include <array>
+#include <cassert>
+#include <stdexcept>
+
+#include "board.h"
+
+namespace
+{
+	// Checked before any table is indexed with it
+	int checkDimension(int dim)
+	{
+		if (dim <= 0 || dim > BitBoard::MAX_DIM)
+			throw std::invalid_argument("board size out of range");
+		return dim;
+	}
+}
+
+BitBoard::BitBoard(int dim) :
+	m_geometry(checkDimension(dim)),
+	m_neighbors(neighborTable(dim))
+{
+}
+
+BitMask const* BitBoard::neighborTable(int dim)
+{
+	using Table = std::array<BitMask, MAX_DIM * MAX_DIM>;
+	static const std::array<Table, MAX_DIM + 1> tables = []() {
+		std::array<Table, MAX_DIM + 1> tables;
+		for (int d = 1; d <= MAX_DIM; ++d) {
+			const RuntimeGeometry g(d);
+			for (int n = 0; n < d * d; ++n) {
+				const BitMask b = BitMask::bit(n);
+				tables[d][n] = north(g, b) | south(g, b) | west(g, b) | east(g, b);
+			}
+		}
+		return tables;
+	}();
+	return tables[dim].data();
+}
+
+Cell BitBoard::get(int n) const
+{
+	if (m_pieces[0].test(n))
+		return Cell::YELLOW;
+	if (m_pieces[1].test(n))
+		return Cell::RED;
+	return Cell::EMPTY;
+}
+
+void BitBoard::set(int n, Cell cell)
+{
+	const BitMask b = BitMask::bit(n);
+	const Cell old = get(n);
+	if (old == cell)
+		return;
+	// A piece leaving can drop the neighbors no other piece of its color
+	// touches. Finding those takes the same shifts as the whole frontier
+	// of that color, so only that one is redone; the freed cell joins the
+	// other frontier if it touches the other color.
+	if (old != Cell::EMPTY) {
+		const int p = (int) old - 1;
+		m_pieces[p] &= ~b;
+		const BitMask own = m_pieces[p];
+		const BitMask free = empty();
+		m_frontier[p] = withGeometry([&](auto const& g) {
+			return free & (north(g, own) | south(g, own) | west(g, own) | east(g, own));
+		});
+		if ((m_neighbors[n] & m_pieces[1 - p]).any())
+			m_frontier[1 - p] |= b;
+	}
+	// A piece arriving leaves both frontiers and brings its empty
+	// neighbors into its own
+	if (cell != Cell::EMPTY) {
+		const int p = (int) cell - 1;
+		m_pieces[p] |= b;
+		m_frontier[0] &= ~b;
+		m_frontier[1] &= ~b;
+		m_frontier[p] |= m_neighbors[n] & empty();
+	}
+}
+
+void BitBoard::setPieces(BitMask yellow, BitMask red)
+{
+	m_pieces[0] = yellow;
+	m_pieces[1] = red;
+	computeFrontiers();
+}
+
+BitMask BitBoard::pieces(Cell player) const
+{
+	assert(player != Cell::EMPTY);
+	return m_pieces[(int) player - 1];
+}
+
+void BitBoard::computeFrontiers()
+{
+	const BitMask free = empty();
+	withGeometry([&](auto const& g) {
+		for (int p = 0; p < 2; ++p) {
+			const BitMask own = m_pieces[p];
+			m_frontier[p] = free &
+				(north(g, own) | south(g, own) | west(g, own) | east(g, own));
+		}
+	});
+}
+
+void BitBoard::moveSources(Cell player, BitMask* from) const
+{
+	const BitMask own = pieces(player);
+	withGeometry([&](auto const& g) {
+		from[0] = south(g, own);
+		from[1] = east(g, own);
+		from[2] = north(g, own);
+		from[3] = west(g, own);
+	});
+}
+
+BitMask BitBoard::captureTargets(Cell player) const
+{
+	const BitMask own = pieces(player);
+	const Cell enemy = player == Cell::RED ? Cell::YELLOW : Cell::RED;
+	const BitMask enemies = pieces(enemy);
+	const BitMask free = empty();
+	return withGeometry([&](auto const& g) {
+		const BitMask prey = enemies & ~g.center;
+		const BitMask targets =
+			south(g, prey & south(g, own)) |
+			north(g, prey & north(g, own)) |
+			east(g, prey & east(g, own)) |
+			west(g, prey & west(g, own));
+		return targets & free;
+	});
+}
+
+BitMask BitBoard::captures(int n, Cell player) const
+{
+	const Cell enemy = player == Cell::RED ? Cell::YELLOW : Cell::RED;
+	return captures(n, pieces(player), pieces(enemy));
+}
+
+BitMask BitBoard::captures(int n, BitMask own, BitMask enemies) const
+{
+	const BitMask b = BitMask::bit(n);
+	return withGeometry([&](auto const& g) {
+		const BitMask prey = enemies & ~g.center;
+		return prey & (
+			(north(g, b) & south(g, own)) |
+			(south(g, b) & north(g, own)) |
+			(west(g, b) & east(g, own)) |
+			(east(g, b) & west(g, own)));
+	});
+}
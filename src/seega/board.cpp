@@ -1,33 +1,19 @@
 #include "board.h"
 
-#include <cassert>
+#include <algorithm>
+#include <stdexcept>
 
 Board::Board(int dim) :
 	m_dim(dim)
 {
-	assert(dim > 0);
-	for (int i = 0; i < dim; ++i) {
-		std::vector<Cell> line(dim);
-		std::fill(line.begin(), line.end(), Cell::EMPTY);
-		m_cells.push_back(line);
-	}
-}
-
-std::vector<Cell> const& Board::operator[](std::size_t i) const
-{
-	assert(i >= 0);
-	assert(i < m_dim);
-	return m_cells[i];
-}
-
-std::vector<Cell>& Board::operator[](std::size_t i)
-{
-	assert(i >= 0);
-	assert(i < m_dim);
-	return m_cells[i];
+	if (dim <= 0)
+		throw std::invalid_argument("board size out of range");
+	std::fill(m_cells.begin(), m_cells.end(), Cell::EMPTY);
+	if (dim > BitBoard::MAX_DIM)
+		m_large_cells.assign((std::size_t) dim * dim, Cell::EMPTY);
 }
 
 int Board::getDimension() const
 {
 	return m_dim;
-}
\ No newline at end of file
+}
@@ -0,0 +1,332 @@
+#include "evaluator.h"
+
+#include <algorithm>
+
+#include "board.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SEEGA_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// MSVC compiles any intrinsic without asking
+#define SEEGA_TARGET(arch)
+#else
+#define SEEGA_TARGET(arch) __attribute__((target(arch)))
+#endif
+#endif
+
+namespace
+{
+	Cell enemyOf(Cell player)
+	{
+		return player == Cell::YELLOW ? Cell::RED : Cell::YELLOW;
+	}
+
+	// Empty cells next to the pieces, as BitBoard::frontier()
+	BitMask frontier(RuntimeGeometry const& g, BitMask own, BitMask free)
+	{
+		const BitMask north = own >> g.dim;
+		const BitMask south = (own << g.dim) & g.valid;
+		const BitMask west = (own & g.not_west) >> 1;
+		const BitMask east = (own & g.not_east) << 1;
+		return free & (north | south | west | east);
+	}
+
+	void evaluateScalar(EvalBatch& batch)
+	{
+		RuntimeGeometry const& g = batch.geometry;
+		for (int k = 0; k < batch.count; ++k) {
+			const BitMask own(batch.own_lo[k], batch.own_hi[k]);
+			const BitMask enemy(batch.enemy_lo[k], batch.enemy_hi[k]);
+			const BitMask free = g.valid & ~(own | enemy);
+			batch.score[k] = 100 * (own.count() - enemy.count())
+				+ frontier(g, own, free).count() - frontier(g, enemy, free).count();
+		}
+	}
+
+#if defined(SEEGA_X86)
+	// Two positions per register. The 128-bit shifts of BitMask become
+	// shifts of each half with the bits crossing over or'ed in.
+	struct Sse2Masks
+	{
+		__m128i valid_lo, valid_hi;
+		__m128i not_west_lo, not_west_hi;
+		__m128i not_east_lo, not_east_hi;
+		__m128i dim, rest, one, sixty_three; // shift counts
+	};
+
+	SEEGA_TARGET("sse2")
+	__m128i set1Sse2(std::uint64_t v)
+	{
+		return _mm_set_epi32((int) (v >> 32), (int) v, (int) (v >> 32), (int) v);
+	}
+
+	SEEGA_TARGET("sse2")
+	void frontierSse2(Sse2Masks const& m, __m128i lo, __m128i hi,
+		__m128i free_lo, __m128i free_hi, __m128i& out_lo, __m128i& out_hi)
+	{
+		// North and south
+		__m128i f_lo = _mm_or_si128(_mm_srl_epi64(lo, m.dim), _mm_sll_epi64(hi, m.rest));
+		__m128i f_hi = _mm_srl_epi64(hi, m.dim);
+		f_lo = _mm_or_si128(f_lo, _mm_and_si128(_mm_sll_epi64(lo, m.dim), m.valid_lo));
+		f_hi = _mm_or_si128(f_hi, _mm_and_si128(m.valid_hi,
+			_mm_or_si128(_mm_sll_epi64(hi, m.dim), _mm_srl_epi64(lo, m.rest))));
+		// West
+		__m128i w_lo = _mm_and_si128(lo, m.not_west_lo);
+		__m128i w_hi = _mm_and_si128(hi, m.not_west_hi);
+		f_lo = _mm_or_si128(f_lo, _mm_or_si128(_mm_srl_epi64(w_lo, m.one),
+			_mm_sll_epi64(w_hi, m.sixty_three)));
+		f_hi = _mm_or_si128(f_hi, _mm_srl_epi64(w_hi, m.one));
+		// East
+		__m128i e_lo = _mm_and_si128(lo, m.not_east_lo);
+		__m128i e_hi = _mm_and_si128(hi, m.not_east_hi);
+		f_lo = _mm_or_si128(f_lo, _mm_sll_epi64(e_lo, m.one));
+		f_hi = _mm_or_si128(f_hi, _mm_or_si128(_mm_sll_epi64(e_hi, m.one),
+			_mm_srl_epi64(e_lo, m.sixty_three)));
+		out_lo = _mm_and_si128(f_lo, free_lo);
+		out_hi = _mm_and_si128(f_hi, free_hi);
+	}
+
+	// Bits set in each byte
+	SEEGA_TARGET("sse2")
+	__m128i byteCountSse2(__m128i v)
+	{
+		const __m128i m1 = _mm_set1_epi8(0x55);
+		const __m128i m2 = _mm_set1_epi8(0x33);
+		const __m128i m4 = _mm_set1_epi8(0x0f);
+		v = _mm_sub_epi8(v, _mm_and_si128(_mm_srli_epi64(v, 1), m1));
+		v = _mm_add_epi8(_mm_and_si128(v, m2), _mm_and_si128(_mm_srli_epi64(v, 2), m2));
+		return _mm_and_si128(_mm_add_epi8(v, _mm_srli_epi64(v, 4)), m4);
+	}
+
+	// Bits set in each 128-bit mask, as two 64-bit counts
+	SEEGA_TARGET("sse2")
+	__m128i countSse2(__m128i lo, __m128i hi)
+	{
+		const __m128i bytes = _mm_add_epi8(byteCountSse2(lo), byteCountSse2(hi));
+		return _mm_sad_epu8(bytes, _mm_setzero_si128());
+	}
+
+	SEEGA_TARGET("sse2")
+	void evaluateSse2(EvalBatch& batch)
+	{
+		RuntimeGeometry const& g = batch.geometry;
+		Sse2Masks m;
+		m.valid_lo = set1Sse2(g.valid.lo);
+		m.valid_hi = set1Sse2(g.valid.hi);
+		m.not_west_lo = set1Sse2(g.not_west.lo);
+		m.not_west_hi = set1Sse2(g.not_west.hi);
+		m.not_east_lo = set1Sse2(g.not_east.lo);
+		m.not_east_hi = set1Sse2(g.not_east.hi);
+		m.dim = _mm_cvtsi32_si128(g.dim);
+		m.rest = _mm_cvtsi32_si128(64 - g.dim);
+		m.one = _mm_cvtsi32_si128(1);
+		m.sixty_three = _mm_cvtsi32_si128(63);
+		for (int k = 0; k < batch.count; k += 2) {
+			const __m128i own_lo = _mm_load_si128((__m128i const*) (batch.own_lo + k));
+			const __m128i own_hi = _mm_load_si128((__m128i const*) (batch.own_hi + k));
+			const __m128i enemy_lo = _mm_load_si128((__m128i const*) (batch.enemy_lo + k));
+			const __m128i enemy_hi = _mm_load_si128((__m128i const*) (batch.enemy_hi + k));
+			const __m128i free_lo = _mm_andnot_si128(_mm_or_si128(own_lo, enemy_lo), m.valid_lo);
+			const __m128i free_hi = _mm_andnot_si128(_mm_or_si128(own_hi, enemy_hi), m.valid_hi);
+			__m128i own_f_lo, own_f_hi, enemy_f_lo, enemy_f_hi;
+			frontierSse2(m, own_lo, own_hi, free_lo, free_hi, own_f_lo, own_f_hi);
+			frontierSse2(m, enemy_lo, enemy_hi, free_lo, free_hi, enemy_f_lo, enemy_f_hi);
+			const __m128i material = _mm_sub_epi64(countSse2(own_lo, own_hi),
+				countSse2(enemy_lo, enemy_hi));
+			const __m128i mobility = _mm_sub_epi64(countSse2(own_f_lo, own_f_hi),
+				countSse2(enemy_f_lo, enemy_f_hi));
+			// 100 * material = 64 * material + 32 * material + 4 * material
+			__m128i score = _mm_add_epi64(_mm_slli_epi64(material, 6),
+				_mm_add_epi64(_mm_slli_epi64(material, 5), _mm_slli_epi64(material, 2)));
+			score = _mm_add_epi64(score, mobility);
+			// Low halves of the two 64-bit scores
+			_mm_storel_epi64((__m128i*) (batch.score + k),
+				_mm_shuffle_epi32(score, _MM_SHUFFLE(3, 1, 2, 0)));
+		}
+	}
+
+	// Four positions per register, with the same steps as the SSE2 kernel
+	// but counting bits with a nibble lookup table
+	struct Avx2Masks
+	{
+		__m256i valid_lo, valid_hi;
+		__m256i not_west_lo, not_west_hi;
+		__m256i not_east_lo, not_east_hi;
+		__m128i dim, rest, one, sixty_three; // shift counts
+	};
+
+	SEEGA_TARGET("avx2")
+	void frontierAvx2(Avx2Masks const& m, __m256i lo, __m256i hi,
+		__m256i free_lo, __m256i free_hi, __m256i& out_lo, __m256i& out_hi)
+	{
+		// North and south
+		__m256i f_lo = _mm256_or_si256(_mm256_srl_epi64(lo, m.dim), _mm256_sll_epi64(hi, m.rest));
+		__m256i f_hi = _mm256_srl_epi64(hi, m.dim);
+		f_lo = _mm256_or_si256(f_lo, _mm256_and_si256(_mm256_sll_epi64(lo, m.dim), m.valid_lo));
+		f_hi = _mm256_or_si256(f_hi, _mm256_and_si256(m.valid_hi,
+			_mm256_or_si256(_mm256_sll_epi64(hi, m.dim), _mm256_srl_epi64(lo, m.rest))));
+		// West
+		__m256i w_lo = _mm256_and_si256(lo, m.not_west_lo);
+		__m256i w_hi = _mm256_and_si256(hi, m.not_west_hi);
+		f_lo = _mm256_or_si256(f_lo, _mm256_or_si256(_mm256_srl_epi64(w_lo, m.one),
+			_mm256_sll_epi64(w_hi, m.sixty_three)));
+		f_hi = _mm256_or_si256(f_hi, _mm256_srl_epi64(w_hi, m.one));
+		// East
+		__m256i e_lo = _mm256_and_si256(lo, m.not_east_lo);
+		__m256i e_hi = _mm256_and_si256(hi, m.not_east_hi);
+		f_lo = _mm256_or_si256(f_lo, _mm256_sll_epi64(e_lo, m.one));
+		f_hi = _mm256_or_si256(f_hi, _mm256_or_si256(_mm256_sll_epi64(e_hi, m.one),
+			_mm256_srl_epi64(e_lo, m.sixty_three)));
+		out_lo = _mm256_and_si256(f_lo, free_lo);
+		out_hi = _mm256_and_si256(f_hi, free_hi);
+	}
+
+	SEEGA_TARGET("avx2")
+	__m256i byteCountAvx2(__m256i v)
+	{
+		const __m256i table = _mm256_setr_epi8(
+			0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+			0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+		const __m256i low = _mm256_set1_epi8(0x0f);
+		return _mm256_add_epi8(
+			_mm256_shuffle_epi8(table, _mm256_and_si256(v, low)),
+			_mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), low)));
+	}
+
+	SEEGA_TARGET("avx2")
+	__m256i countAvx2(__m256i lo, __m256i hi)
+	{
+		const __m256i bytes = _mm256_add_epi8(byteCountAvx2(lo), byteCountAvx2(hi));
+		return _mm256_sad_epu8(bytes, _mm256_setzero_si256());
+	}
+
+	SEEGA_TARGET("avx2")
+	void evaluateAvx2(EvalBatch& batch)
+	{
+		RuntimeGeometry const& g = batch.geometry;
+		Avx2Masks m;
+		m.valid_lo = _mm256_set1_epi64x((long long) g.valid.lo);
+		m.valid_hi = _mm256_set1_epi64x((long long) g.valid.hi);
+		m.not_west_lo = _mm256_set1_epi64x((long long) g.not_west.lo);
+		m.not_west_hi = _mm256_set1_epi64x((long long) g.not_west.hi);
+		m.not_east_lo = _mm256_set1_epi64x((long long) g.not_east.lo);
+		m.not_east_hi = _mm256_set1_epi64x((long long) g.not_east.hi);
+		m.dim = _mm_cvtsi32_si128(g.dim);
+		m.rest = _mm_cvtsi32_si128(64 - g.dim);
+		m.one = _mm_cvtsi32_si128(1);
+		m.sixty_three = _mm_cvtsi32_si128(63);
+		const __m256i low_halves = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+		for (int k = 0; k < batch.count; k += 4) {
+			const __m256i own_lo = _mm256_load_si256((__m256i const*) (batch.own_lo + k));
+			const __m256i own_hi = _mm256_load_si256((__m256i const*) (batch.own_hi + k));
+			const __m256i enemy_lo = _mm256_load_si256((__m256i const*) (batch.enemy_lo + k));
+			const __m256i enemy_hi = _mm256_load_si256((__m256i const*) (batch.enemy_hi + k));
+			const __m256i free_lo = _mm256_andnot_si256(_mm256_or_si256(own_lo, enemy_lo), m.valid_lo);
+			const __m256i free_hi = _mm256_andnot_si256(_mm256_or_si256(own_hi, enemy_hi), m.valid_hi);
+			__m256i own_f_lo, own_f_hi, enemy_f_lo, enemy_f_hi;
+			frontierAvx2(m, own_lo, own_hi, free_lo, free_hi, own_f_lo, own_f_hi);
+			frontierAvx2(m, enemy_lo, enemy_hi, free_lo, free_hi, enemy_f_lo, enemy_f_hi);
+			const __m256i material = _mm256_sub_epi64(countAvx2(own_lo, own_hi),
+				countAvx2(enemy_lo, enemy_hi));
+			const __m256i mobility = _mm256_sub_epi64(countAvx2(own_f_lo, own_f_hi),
+				countAvx2(enemy_f_lo, enemy_f_hi));
+			__m256i score = _mm256_add_epi64(_mm256_slli_epi64(material, 6),
+				_mm256_add_epi64(_mm256_slli_epi64(material, 5), _mm256_slli_epi64(material, 2)));
+			score = _mm256_add_epi64(score, mobility);
+			_mm_store_si128((__m128i*) (batch.score + k),
+				_mm256_castsi256_si128(_mm256_permutevar8x32_epi32(score, low_halves)));
+		}
+	}
+#endif
+}
+
+EvalBatch::EvalBatch(int dim) :
+	geometry(dim),
+	count(0),
+	own_lo(),
+	own_hi(),
+	enemy_lo(),
+	enemy_hi(),
+	score()
+{
+}
+
+int EvalBatch::add(BitBoard const& bits, Cell player)
+{
+	return add(bits.pieces(player), bits.pieces(enemyOf(player)));
+}
+
+int EvalBatch::add(BitMask own, BitMask enemy)
+{
+	own_lo[count] = own.lo;
+	own_hi[count] = own.hi;
+	enemy_lo[count] = enemy.lo;
+	enemy_hi[count] = enemy.hi;
+	return count++;
+}
+
+SimdLevel BatchEvaluator::detect()
+{
+#if defined(SEEGA_X86) && defined(_MSC_VER) && !defined(__clang__)
+	int info[4];
+	__cpuid(info, 0);
+	const int max_leaf = info[0];
+	__cpuid(info, 1);
+	const bool sse2 = (info[3] & (1 << 26)) != 0;
+	// AVX2 also needs the OS to save the ymm registers
+	const bool os_ymm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+	bool avx2 = false;
+	if (max_leaf >= 7 && os_ymm) {
+		__cpuidex(info, 7, 0);
+		avx2 = (info[1] & (1 << 5)) != 0;
+	}
+	return avx2 ? SimdLevel::AVX2 : sse2 ? SimdLevel::SSE2 : SimdLevel::SCALAR;
+#elif defined(SEEGA_X86)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return SimdLevel::AVX2;
+	if (__builtin_cpu_supports("sse2"))
+		return SimdLevel::SSE2;
+	return SimdLevel::SCALAR;
+#else
+	return SimdLevel::SCALAR;
+#endif
+}
+
+const char* BatchEvaluator::getName(SimdLevel level)
+{
+	switch (level) {
+	case SimdLevel::AVX2:
+		return "avx2";
+	case SimdLevel::SSE2:
+		return "sse2";
+	default:
+		return "scalar";
+	}
+}
+
+BatchEvaluator::BatchEvaluator(SimdLevel level) :
+	m_level(std::min(level, detect())),
+	m_kernel(evaluateScalar)
+{
+#if defined(SEEGA_X86)
+	if (m_level == SimdLevel::AVX2)
+		m_kernel = evaluateAvx2;
+	else if (m_level == SimdLevel::SSE2)
+		m_kernel = evaluateSse2;
+#endif
+}
+
+void BatchEvaluator::evaluate(EvalBatch& batch) const
+{
+	m_kernel(batch);
+}
+
+int BatchEvaluator::evaluate(BitBoard const& bits, Cell player)
+{
+	const Cell enemy = enemyOf(player);
+	return 100 * (bits.pieces(player).count() - bits.pieces(enemy).count())
+		+ bits.frontier(player).count() - bits.frontier(enemy).count();
+}
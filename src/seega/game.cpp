@@ -1,15 +1,37 @@
 #include "game.h"
 
+#include <algorithm>
+#include <cassert>
 #include <iostream>
-#include <numeric>
+#include <stdexcept>
 
 #include "board.h"
+#include "agent.h"
+#include "gamerecord.h"
+#include "openingbook.h"
+#include "symmetry.h"
+#include "tablebase.h"
+#include "trace.h"
+#include "zobrist.h"
+
+namespace
+{
+	// Boards too large for a bitboard leave it 1x1 and unused
+	int bitsDimension(int dim)
+	{
+		return dim <= BitBoard::MAX_DIM ? dim : 1;
+	}
+}
 
 Game::Game(int dim, bool ai, std::default_random_engine& rng) :
 	m_board(std::make_shared<Board>(dim)),
+	m_bits(bitsDimension(dim)),
+	m_placement(dim),
 	m_turn(rng() % 2 == 0 ? Cell::YELLOW : Cell::RED),
 	m_stage(Stage::PLACING_PIECES),
 	m_remaining_pieces_to_place(2),
+	m_ply_count(0),
+	m_verbose(true),
 	m_yellow_pieces(0),
 	m_red_pieces(0),
 	m_ai(ai),
@@ -17,6 +39,50 @@ Game::Game(int dim, bool ai, std::default_random_engine& rng) :
 {
 	std::fill(m_last_move, m_last_move + 4, 0);
 	m_ai_turn = getEnemy(m_turn);
+	m_hash = zobrist::hash(m_bits, m_turn, isHalfTurn());
+}
+
+Game::Game(int dim, Cell first) :
+	m_board(std::make_shared<Board>(dim)),
+	m_bits(bitsDimension(dim)),
+	m_placement(dim),
+	m_turn(first),
+	m_stage(Stage::PLACING_PIECES),
+	m_remaining_pieces_to_place(2),
+	m_ply_count(0),
+	m_verbose(false),
+	m_yellow_pieces(0),
+	m_red_pieces(0),
+	m_ai(false)
+{
+	if (first != Cell::YELLOW && first != Cell::RED)
+		throw std::invalid_argument("the first player must be yellow or red");
+	std::fill(m_last_move, m_last_move + 4, 0);
+	m_ai_turn = getEnemy(m_turn);
+	m_hash = zobrist::hash(m_bits, m_turn, isHalfTurn());
+}
+
+Game::Game(Game const& other) :
+	m_board(std::make_shared<Board>(*other.m_board)),
+	m_bits(other.m_bits),
+	m_placement(other.m_placement),
+	m_hash(other.m_hash),
+	m_yellow_pieces(other.m_yellow_pieces),
+	m_red_pieces(other.m_red_pieces),
+	m_remaining_pieces_to_place(other.m_remaining_pieces_to_place),
+	m_ply_count(other.m_ply_count),
+	m_verbose(other.m_verbose),
+	m_rng(other.m_rng),
+	m_agents{ other.m_agents[0], other.m_agents[1] },
+	m_tablebase(other.m_tablebase),
+	m_book(other.m_book),
+	m_ai(other.m_ai),
+	m_last_removed(other.m_last_removed),
+	m_stage(other.m_stage),
+	m_turn(other.m_turn),
+	m_ai_turn(other.m_ai_turn)
+{
+	std::copy(other.m_last_move, other.m_last_move + 4, m_last_move);
 }
 
 Cell Game::getTurn() const
@@ -34,6 +100,11 @@ std::shared_ptr<Board const> Game::getBoard() const
 	return m_board;
 }
 
+BitBoard const& Game::getBits() const
+{
+	return m_bits;
+}
+
 Game::Stage Game::getStage() const
 {
 	return m_stage;
@@ -44,6 +115,62 @@ bool Game::isOver() const
 	return m_stage == Game::Stage::END;
 }
 
+Cell Game::getWinner() const
+{
+	if (!isOver())
+		return Cell::EMPTY;
+	return m_red_pieces == 0 ? Cell::YELLOW : Cell::RED;
+}
+
+int Game::getPlyCount() const
+{
+	return m_ply_count;
+}
+
+std::uint64_t Game::getHash() const
+{
+	return m_hash;
+}
+
+std::uint64_t Game::getCanonicalHash(int& transform) const
+{
+	if (isLarge()) {
+		transform = 0;
+		return m_hash;
+	}
+	return symmetry::canonicalHash(m_bits, m_turn, isHalfTurn(), transform);
+}
+
+void Game::setVerbose(bool verbose)
+{
+	m_verbose = verbose;
+}
+
+void Game::setAgent(Cell player, std::shared_ptr<Agent> agent)
+{
+	m_agents[(int) player - 1] = agent;
+}
+
+void Game::setAgent(std::shared_ptr<Agent> agent)
+{
+	m_agents[0] = m_agents[1] = agent;
+}
+
+std::shared_ptr<Agent> Game::getAgent(Cell player) const
+{
+	return m_agents[(int) player - 1];
+}
+
+void Game::setTablebase(std::shared_ptr<Tablebase const> tablebase)
+{
+	m_tablebase = tablebase;
+}
+
+void Game::setOpeningBook(std::shared_ptr<OpeningBook const> book)
+{
+	m_book = book;
+}
+
 bool Game::canMovePieces() const
 {
 	return m_stage == Game::Stage::PLAYING && !isAiTurn();
@@ -75,116 +202,101 @@ bool Game::isCentralCell(int i, int j) const
 	return i == dim / 2 && j == dim / 2;
 }
 
+bool Game::isLarge() const
+{
+	return m_board->getDimension() > BitBoard::MAX_DIM;
+}
+
+bool Game::isHalfTurn() const
+{
+	return m_stage == Game::Stage::PLACING_PIECES &&
+		m_remaining_pieces_to_place == 1;
+}
+
+bool Game::inTablebase() const
+{
+	return m_tablebase && m_stage == Game::Stage::PLAYING &&
+		m_yellow_pieces + m_red_pieces <= m_tablebase->getMaxPieces();
+}
+
 bool Game::letAiPlay()
 {
 	if (!isAiTurn())
 		return false;
-	switch (m_stage) {
-	case Game::Stage::PLACING_PIECES:
-		return chooseCellToPlace();
-	case Game::Stage::PLAYING:
-		return chooseMove();
-	default:
+	return autoPlay();
+}
+
+bool Game::autoPlay()
+{
+	Move move;
+	return chooseAiMove(move) && applyMove(move);
+}
+
+bool Game::chooseAiMove(Move& move)
+{
+	SEEGA_TRACE_SCOPE(m_stage == Stage::PLACING_PIECES
+		? trace::Point::CHOOSE_PLACEMENT : trace::Point::CHOOSE_MOVE);
+	static RandomAgent random_agent; // Keeps no state, so threads share it
+	// Every engine works on the bitboard
+	if (isLarge())
+		return random_agent.chooseMove(*this, m_rng, move);
+	// Known openings need no thinking
+	if (m_book && m_book->chooseMove(*this, move))
+		return true;
+	// The tables beat any search once they cover the position
+	if (inTablebase() && m_tablebase->chooseMove(*this, move))
+		return true;
+	Agent& agent = m_agents[(int) m_turn - 1] ? *m_agents[(int) m_turn - 1] : random_agent;
+	return agent.chooseMove(*this, m_rng, move);
+}
+
+bool Game::playAiMove(Move move)
+{
+	if (!isAiTurn())
 		return false;
-	}
+	return applyMove(move);
 }
 
-bool Game::chooseCellToPlace()
+bool Game::applyMove(Move move)
 {
-	int i_ = 0, j_ = 0;
 	const int dim = m_board->getDimension();
-	const int piece_cnt = (m_turn == Cell::RED)
-		? m_red_pieces : m_yellow_pieces;
-	float ic = 0.f, jc = 0.f;
-	if (piece_cnt == 0) {
-		ic = jc = (float) dim / 2;
-	} else {
-		for (int i = 0; i < dim; ++i)
-			for (int j = 0; j < dim; ++j)
-				if ((*m_board)[i][j] == m_turn) {
-					ic += (float) i / piece_cnt;
-					jc += (float) j / piece_cnt;
-				}
-	}
-	std::vector<std::pair<int, int>> empty_spaces;
-	std::vector<float> cell_dists;
-	for (int i = 0; i < dim; ++i)
-		for (int j = 0; j < dim; ++j)
-			if ((*m_board)[i][j] == Cell::EMPTY && !isCentralCell(i, j)) {
-				float di = (float) i - ic;
-				float dj = (float) j - jc;
-				float dist = di * di + dj * dj;
-				empty_spaces.push_back(std::make_pair(i, j));
-				cell_dists.push_back(dist);
-				i_ = i;
-				j_ = j;
-			}
-	float dist_sum = std::accumulate(cell_dists.begin(), cell_dists.end(), 0.f);
-	auto unif = std::uniform_real_distribution<float>();
-	float u = unif(m_rng);
-	float x = 0.f;
-	for (std::size_t i = 0; i < cell_dists.size(); ++i) {
-		if (u - x <= 1E-6f) {
-			auto chosen = empty_spaces[i];
-			i_ = chosen.first;
-			j_ = chosen.second;
-			break;
-		}
-		x += cell_dists[i] / dist_sum;
-	}
-	return placePiecePrivate(i_, j_);
+	if (move.from == move.to)
+		return placePiecePrivate(move.to / dim, move.to % dim);
+	return movePiecePrivate(move.from / dim, move.from % dim,
+		move.to / dim, move.to % dim);
 }
 
-bool Game::chooseMove()
+bool Game::ponder()
 {
-	const int dim = m_board->getDimension();
-	std::vector<std::tuple<int, int, int, int>> moves;
-	for (int i = 0; i < dim; ++i)
-		for (int j = 0; j < dim; ++j)
-			if ((*m_board)[i][j] == Cell::EMPTY) {
-				if (i > 0 && (*m_board)[(std::size_t) i - 1][j] == m_turn)
-					moves.push_back(std::make_tuple(i - 1, j, i, j));
-				if (j > 0 && (*m_board)[i][(std::size_t) j - 1] == m_turn)
-					moves.push_back(std::make_tuple(i, j - 1, i, j));
-				if (i < dim - 1 && (*m_board)[(std::size_t) i + 1][j] == m_turn)
-					moves.push_back(std::make_tuple(i + 1, j, i, j));
-				if (j < dim - 1 && (*m_board)[i][(std::size_t) j + 1] == m_turn)
-					moves.push_back(std::make_tuple(i, j + 1, i, j));
-			}
-	const auto enemy = getEnemy(m_turn);
-	for (auto const& [i_ini, j_ini, i_fin, j_fin] : moves) {
-		if (i_fin >= 2 && !isCentralCell(i_fin - 1, j_fin)) {
-			Cell& north_cell = (*m_board)[(std::size_t) i_fin - 1][j_fin];
-			Cell north_north_cell = (*m_board)[(std::size_t) i_fin - 2][j_fin];
-			if (north_north_cell == m_turn && north_cell == enemy)
-				return movePiecePrivate(i_ini, j_ini, i_fin, j_fin);
-		}
-		// South
-		if (i_fin <= dim - 3 && !isCentralCell(i_fin + 1, j_fin)) {
-			Cell& south_cell = (*m_board)[(std::size_t) i_fin + 1][j_fin];
-			Cell south_south_cell = (*m_board)[(std::size_t) i_fin + 2][j_fin];
-			if (south_south_cell == m_turn && south_cell == enemy)
-				return movePiecePrivate(i_ini, j_ini, i_fin, j_fin);
-		}
-		// West
-		if (j_fin >= 2 && !isCentralCell(i_fin, j_fin - 1)) {
-			Cell& west_cell = (*m_board)[i_fin][(std::size_t) j_fin - 1];
-			Cell west_west_cell = (*m_board)[i_fin][(std::size_t) j_fin - 2];
-			if (west_west_cell == m_turn && west_cell == enemy)
-				return movePiecePrivate(i_ini, j_ini, i_fin, j_fin);
-		}
-		// East
-		if (j_fin <= dim - 3 && !isCentralCell(i_fin, j_fin + 1)) {
-			Cell& east_cell = (*m_board)[i_fin][(std::size_t) j_fin + 1];
-			Cell east_east_cell = (*m_board)[i_fin][(std::size_t) j_fin + 2];
-			if (east_east_cell == m_turn && east_cell == enemy)
-				return movePiecePrivate(i_ini, j_ini, i_fin, j_fin);
-		}
-	}
-	decltype(moves) chosen_move(1);
-	std::sample(moves.begin(), moves.end(), chosen_move.begin(), 1, m_rng);
-	auto const& [i_ini, j_ini, i_fin, j_fin] = chosen_move[0];
-	return movePiecePrivate(i_ini, j_ini, i_fin, j_fin);
+	if (!m_ai || isLarge() || isOver() || isAiTurn() || inTablebase())
+		return false;
+	Agent* agent = m_agents[(int) m_ai_turn - 1].get();
+	if (!agent)
+		return false;
+	Move moves[MAX_MOVES];
+	if (getLegalMoves(moves) == 0)
+		return false;
+	return agent->ponder(*this);
+}
+
+void Game::setRecord(std::shared_ptr<GameRecord> record)
+{
+	assert(m_ply_count == 0);
+	m_record = record;
+	if (m_record)
+		m_record->begin(m_board->getDimension(), m_turn);
+}
+
+void Game::reseed(unsigned int seed)
+{
+	m_rng.seed(seed);
+}
+
+void Game::setStopFlag(std::atomic<bool> const* stop)
+{
+	for (auto const& agent : m_agents)
+		if (agent)
+			agent->setStopFlag(stop);
 }
 
 bool Game::placePiece(int i, int j)
@@ -196,24 +308,55 @@ bool Game::placePiece(int i, int j)
 
 bool Game::placePiecePrivate(int i, int j)
 {
+	SEEGA_TRACE_SCOPE(trace::Point::PLACE_PIECE);
 	const int dim = m_board->getDimension();
 	if (i < 0 || i >= dim || j < 0 || j >= dim)
 		return false; // Invalid indices
+	Undo undo;
+	if (!makePlacement(i * dim + j, undo))
+		return false;
+	if (m_record)
+		m_record->add(undo.move);
+	return true;
+}
+
+bool Game::makePlacement(int n, Undo& undo)
+{
+	const int dim = m_board->getDimension();
+	if (n < 0 || n >= dim * dim)
+		return false; // Invalid index
+	const int i = n / dim, j = n % dim;
+	if (m_stage != Game::Stage::PLACING_PIECES)
+		return false;
 	if (isCentralCell(i, j))
 		return false; // Central cell
-	Cell& cell = (*m_board)[i][j];
-	if (cell != Cell::EMPTY)
+	if ((*m_board)[i][j] != Cell::EMPTY)
 		return false;
-	cell = m_turn;
+	saveState(undo);
+	undo.move = Move{ (std::uint16_t) n, (std::uint16_t) n };
+	const bool was_half_turn = isHalfTurn();
+	setCell(i, j, m_turn);
+	m_placement.place(n, m_turn);
+	++m_ply_count;
 	addPlacedPieces();
 	if (--m_remaining_pieces_to_place == 0 &&
 		m_stage == Game::Stage::PLACING_PIECES) {
 		m_remaining_pieces_to_place = 2;
 		nextTurn();
 	}
+	if (isHalfTurn() != was_half_turn)
+		m_hash ^= zobrist::halfTurn();
 	return true;
 }
 
+void Game::unmakePlacement(Undo const& undo)
+{
+	const int dim = m_board->getDimension();
+	setCell(undo.move.to / dim, undo.move.to % dim, Cell::EMPTY);
+	m_placement.unplace(undo.move.to, undo.turn);
+	restoreState(undo);
+}
+
 bool Game::movePiece(int i_ini, int j_ini, int i_fin, int j_fin)
 {
 	if (!canMovePieces())
@@ -223,21 +366,78 @@ bool Game::movePiece(int i_ini, int j_ini, int i_fin, int j_fin)
 
 bool Game::movePiecePrivate(int i_ini, int j_ini, int i_fin, int j_fin)
 {
+	SEEGA_TRACE_SCOPE(trace::Point::MOVE_PIECE);
 	const int dim = m_board->getDimension();
 
 	// Check validity of move
 	if (i_ini < 0 || i_ini >= dim || j_ini < 0 || j_ini >= dim ||
 		i_fin < 0 || i_fin >= dim || j_fin < 0 || j_fin >= dim)
 		return false; // Invalid indices
+	Undo undo;
+	const Move move{ (std::uint16_t) (i_ini * dim + j_ini),
+		(std::uint16_t) (i_fin * dim + j_fin) };
+	if (!makeMove(move, undo))
+		return false;
+	if (m_record)
+		m_record->add(move);
+
+	// Save last removed
+	m_last_removed.clear();
+	for (int k = 0; k < undo.capture_count; ++k)
+		m_last_removed.push_back(std::make_pair(
+			undo.captured[k] / dim, undo.captured[k] % dim));
+
+	if (m_verbose && m_stage == Game::Stage::END)
+		std::cout << (m_red_pieces == 0 ? "Yellow won!\n" : "Red won!\n");
+	return true;
+}
+
+int Game::getLegalMoves(Move* moves) const
+{
+	if (isLarge())
+		return 0;
+	int count = 0;
+	switch (m_stage) {
+	case Game::Stage::PLACING_PIECES: {
+		BitMask cells = m_bits.empty() & ~m_bits.center();
+		while (cells.any()) {
+			const std::uint8_t n = (std::uint8_t) cells.pop();
+			moves[count++] = Move{ n, n };
+		}
+		break;
+	}
+	case Game::Stage::PLAYING:
+		m_bits.forEachMove(m_turn, [&](int from, int to) {
+			moves[count++] = Move{ (std::uint8_t) from, (std::uint8_t) to };
+		});
+		break;
+	default:
+		break;
+	}
+	return count;
+}
+
+bool Game::makeMove(Move move, Undo& undo)
+{
+	const int dim = m_board->getDimension();
+	const int i_ini = move.from / dim, j_ini = move.from % dim;
+	const int i_fin = move.to / dim, j_fin = move.to % dim;
+
+	// Check validity of move
+	if (move.from >= dim * dim || move.to >= dim * dim)
+		return false; // Invalid indices
+	if (m_stage != Game::Stage::PLAYING)
+		return false;
 	if (std::abs(i_ini - i_fin) + std::abs(j_ini - j_fin) != 1)
 		return false; // Invalid move
-	Cell& cell_ini = (*m_board)[i_ini][j_ini];
-	if (cell_ini != m_turn)
+	if ((*m_board)[i_ini][j_ini] != m_turn)
 		return false;
-	Cell& cell_fin = (*m_board)[i_fin][j_fin];
-	if (cell_fin != Cell::EMPTY)
+	if ((*m_board)[i_fin][j_fin] != Cell::EMPTY)
 		return false; // Tried to move piece to not empty cell
 
+	saveState(undo);
+	undo.move = move;
+
 	// Save last mvoe
 	m_last_move[0] = i_ini;
 	m_last_move[1] = j_ini;
@@ -245,13 +445,11 @@ bool Game::movePiecePrivate(int i_ini, int j_ini, int i_fin, int j_fin)
 	m_last_move[3] = j_fin;
 
 	// Process move
-	std::swap(cell_ini, cell_fin);
-	processMove(i_fin, j_fin);
-	if (m_red_pieces == 0) {
-		std::cout << "Yellow won!\n";
-		m_stage = Game::Stage::END;
-	} else if (m_yellow_pieces == 0) {
-		std::cout << "Red won!\n";
+	setCell(i_ini, j_ini, Cell::EMPTY);
+	setCell(i_fin, j_fin, m_turn);
+	processMove(i_fin, j_fin, undo);
+	++m_ply_count;
+	if (m_red_pieces == 0 || m_yellow_pieces == 0) {
 		m_stage = Game::Stage::END;
 	} else {
 		// If enemy player doesn't have move, keep the current one
@@ -261,68 +459,111 @@ bool Game::movePiecePrivate(int i_ini, int j_ini, int i_fin, int j_fin)
 	return true;
 }
 
+void Game::unmakeMove(Undo const& undo)
+{
+	const int dim = m_board->getDimension();
+	const Cell enemy = getEnemy(undo.turn);
+	for (int k = 0; k < undo.capture_count; ++k)
+		setCell(undo.captured[k] / dim, undo.captured[k] % dim, enemy);
+	setCell(undo.move.to / dim, undo.move.to % dim, Cell::EMPTY);
+	setCell(undo.move.from / dim, undo.move.from % dim, undo.turn);
+	restoreState(undo);
+}
+
+void Game::saveState(Undo& undo) const
+{
+	undo.capture_count = 0;
+	undo.yellow_pieces = m_yellow_pieces;
+	undo.red_pieces = m_red_pieces;
+	undo.remaining_pieces_to_place = m_remaining_pieces_to_place;
+	undo.ply_count = m_ply_count;
+	std::copy(m_last_move, m_last_move + 4, undo.last_move);
+	undo.hash = m_hash;
+	undo.stage = m_stage;
+	undo.turn = m_turn;
+}
+
+void Game::restoreState(Undo const& undo)
+{
+	m_yellow_pieces = undo.yellow_pieces;
+	m_red_pieces = undo.red_pieces;
+	m_remaining_pieces_to_place = undo.remaining_pieces_to_place;
+	m_ply_count = undo.ply_count;
+	std::copy(undo.last_move, undo.last_move + 4, m_last_move);
+	m_hash = undo.hash;
+	m_stage = undo.stage;
+	m_turn = undo.turn;
+}
+
 bool Game::hasPossibleMove(Cell player) const
+{
+	SEEGA_TRACE_SCOPE(trace::Point::HAS_POSSIBLE_MOVE);
+	if (isLarge())
+		return boardHasMove(player);
+	return m_bits.hasMove(player);
+}
+
+bool Game::boardHasMove(Cell player) const
 {
 	const int dim = m_board->getDimension();
 	for (int i = 0; i < dim; ++i)
 		for (int j = 0; j < dim; ++j)
 			if ((*m_board)[i][j] == Cell::EMPTY) {
-				if (i > 0 && (*m_board)[(std::size_t) i - 1][j] == player)
+				if (i > 0 && (*m_board)[i - 1][j] == player)
 					return true;
-				if (i < dim - 1 && (*m_board)[(std::size_t) i + 1][j] == player)
+				if (i < dim - 1 && (*m_board)[i + 1][j] == player)
 					return true;
-				if (j > 0 && (*m_board)[i][(std::size_t) j - 1] == player)
+				if (j > 0 && (*m_board)[i][j - 1] == player)
 					return true;
-				if (j < dim - 1 && (*m_board)[i][(std::size_t) j + 1] == player)
+				if (j < dim - 1 && (*m_board)[i][j + 1] == player)
 					return true;
 			}
 	return false;
 }
 
-void Game::processMove(int i, int j)
+int Game::boardCaptures(int i, int j, Cell player, int* captured) const
 {
+	static const int STEPS[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
 	const int dim = m_board->getDimension();
-	Cell cell = (*m_board)[i][j];
-
-	// Clear last removed
-	m_last_removed.clear();
-
-	// North
-	if (i >= 2 && !isCentralCell(i - 1, j)) {
-		Cell& north_cell = (*m_board)[(std::size_t) i - 1][j];
-		Cell north_north_cell = (*m_board)[(std::size_t) i - 2][j];
-		if (north_north_cell == cell && north_cell == getEnemy(cell))
-			eliminateCell(i - 1, j);
+	const Cell enemy = getEnemy(player);
+	int count = 0;
+	for (auto const& step : STEPS) {
+		const int i_mid = i + step[0], j_mid = j + step[1];
+		const int i_far = i + 2 * step[0], j_far = j + 2 * step[1];
+		if (i_far < 0 || i_far >= dim || j_far < 0 || j_far >= dim)
+			continue;
+		if (!isCentralCell(i_mid, j_mid) && (*m_board)[i_mid][j_mid] == enemy &&
+			(*m_board)[i_far][j_far] == player)
+			captured[count++] = i_mid * dim + j_mid;
 	}
-	// South
-	if (i <= dim - 3 && !isCentralCell(i + 1, j)) {
-		Cell& south_cell = (*m_board)[(std::size_t) i + 1][j];
-		Cell south_south_cell = (*m_board)[(std::size_t) i + 2][j];
-		if (south_south_cell == cell && south_cell == getEnemy(cell))
-			eliminateCell(i + 1, j);
-	}
-	// West
-	if (j >= 2 && !isCentralCell(i, j - 1)) {
-		Cell& west_cell = (*m_board)[i][(std::size_t) j - 1];
-		Cell west_west_cell = (*m_board)[i][(std::size_t) j - 2];
-		if (west_west_cell == cell && west_cell == getEnemy(cell))
-			eliminateCell(i, j - 1);
+	return count;
+}
+
+void Game::processMove(int i, int j, Undo& undo)
+{
+	SEEGA_TRACE_SCOPE(trace::Point::PROCESS_MOVE);
+	const int dim = m_board->getDimension();
+	if (isLarge()) {
+		int captured[4];
+		const int count = boardCaptures(i, j, (*m_board)[i][j], captured);
+		for (int k = 0; k < count; ++k) {
+			undo.captured[undo.capture_count++] = (std::uint16_t) captured[k];
+			eliminateCell(captured[k] / dim, captured[k] % dim);
+		}
+		return;
 	}
-	// East
-	if (j <= dim - 3 && !isCentralCell(i, j + 1)) {
-		Cell& east_cell = (*m_board)[i][(std::size_t) j + 1];
-		Cell east_east_cell = (*m_board)[i][(std::size_t) j + 2];
-		if (east_east_cell == cell && east_cell == getEnemy(cell))
-			eliminateCell(i, j + 1);
+	const int n = m_bits.index(i, j);
+	BitMask captured = m_bits.captures(n, m_bits.get(n));
+	while (captured.any()) {
+		const int c = captured.pop();
+		undo.captured[undo.capture_count++] = (std::uint16_t) c;
+		eliminateCell(c / dim, c % dim);
 	}
 }
 
 void Game::eliminateCell(int i, int j)
 {
-	m_last_removed.push_back(std::make_pair(i, j));
-
-	auto& cell = (*m_board)[i][j];
-	switch (cell) {
+	switch ((*m_board)[i][j]) {
 	case Cell::YELLOW:
 		--m_yellow_pieces;
 		break;
@@ -332,12 +573,23 @@ void Game::eliminateCell(int i, int j)
 	default:
 		return;
 	}
-	cell = Cell::EMPTY;
+	setCell(i, j, Cell::EMPTY);
+}
+
+void Game::setCell(int i, int j, Cell cell)
+{
+	(*m_board)[i][j] = cell;
+	if (isLarge())
+		return;
+	const int n = m_bits.index(i, j);
+	m_hash ^= zobrist::cell(n, m_bits.get(n)) ^ zobrist::cell(n, cell);
+	m_bits.set(n, cell);
 }
 
 void Game::nextTurn()
 {
 	m_turn = getEnemy(m_turn);
+	m_hash ^= zobrist::redTurn();
 }
 
 Cell Game::getEnemy(Cell me) const
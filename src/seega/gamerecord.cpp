@@ -0,0 +1,325 @@
+#include "gamerecord.h"
+
+#include <algorithm>
+
+#include "board.h"
+
+namespace
+{
+	constexpr std::uint32_t MAGIC = 0x43524753; // "SGRC"
+	constexpr std::uint32_t VERSION = 1;
+	constexpr std::size_t HEADER_SIZE = 4 * sizeof(std::uint32_t);
+	constexpr std::size_t GAME_HEADER_SIZE = 20;
+	constexpr std::size_t FOOTER_SIZE = 2 * sizeof(std::uint64_t) + sizeof(std::uint32_t);
+
+	void writeU32(std::ostream& out, std::uint32_t value)
+	{
+		for (int b = 0; b < 4; ++b)
+			out.put((char) (value >> (8 * b)));
+	}
+
+	void writeU64(std::ostream& out, std::uint64_t value)
+	{
+		for (int b = 0; b < 8; ++b)
+			out.put((char) (value >> (8 * b)));
+	}
+
+	std::uint64_t readLE(unsigned char const* data, int bytes)
+	{
+		std::uint64_t value = 0;
+		for (int b = bytes - 1; b >= 0; --b)
+			value = (value << 8) | data[b];
+		return value;
+	}
+
+	int placementCount(int dim)
+	{
+		return dim * dim - 1; // every cell but the center
+	}
+
+	// Bytes of packed plies of a game
+	std::size_t payloadSize(int dim, int cell_bits, int plies)
+	{
+		const int placements = std::min(plies, placementCount(dim));
+		const std::size_t bits = (std::size_t) placements * cell_bits +
+			(std::size_t) (plies - placements) * (cell_bits + 2);
+		return (bits + 7) / 8;
+	}
+
+	bool validCell(int value)
+	{
+		return value >= (int) Cell::EMPTY && value <= (int) Cell::RED;
+	}
+}
+
+GameRecord::GameRecord() :
+	m_dim(0),
+	m_cell_bits(0),
+	m_first(Cell::EMPTY),
+	m_seed(0),
+	m_number(0),
+	m_plies(0),
+	m_bit(0)
+{
+}
+
+void GameRecord::begin(int dim, Cell first)
+{
+	m_dim = dim;
+	m_cell_bits = cellBits(dim);
+	m_first = first;
+	m_plies = 0;
+	m_bit = 0;
+	m_bytes.clear();
+}
+
+void GameRecord::add(Move move)
+{
+	if (m_plies < placementCount(m_dim)) {
+		put(move.to, m_cell_bits);
+	} else {
+		// North, south, west, east
+		const int step = (int) move.to - (int) move.from;
+		const unsigned int direction = step == -m_dim ? 0 : step == m_dim ? 1 :
+			step == -1 ? 2 : 3;
+		put(move.from, m_cell_bits);
+		put(direction, 2);
+	}
+	++m_plies;
+}
+
+void GameRecord::setOrigin(std::uint32_t seed, std::uint64_t number)
+{
+	m_seed = seed;
+	m_number = number;
+}
+
+int GameRecord::cellBits(int dim)
+{
+	int bits = 1;
+	while ((1 << bits) < dim * dim)
+		++bits;
+	return bits;
+}
+
+void GameRecord::put(unsigned int value, int bits)
+{
+	// Least significant bit first
+	for (int b = 0; b < bits; ++b, ++m_bit) {
+		if (m_bit % 8 == 0)
+			m_bytes.push_back(0);
+		if (value >> b & 1)
+			m_bytes.back() |= (unsigned char) (1 << (m_bit % 8));
+	}
+}
+
+RecordView::RecordView() :
+	m_data(nullptr),
+	m_dim(0),
+	m_cell_bits(0),
+	m_first(Cell::EMPTY),
+	m_winner(Cell::EMPTY),
+	m_seed(0),
+	m_number(0),
+	m_plies(0)
+{
+}
+
+Move RecordView::getMove(int ply) const
+{
+	const int placements = placementCount(m_dim);
+	if (ply < placements) {
+		const std::uint8_t n = (std::uint8_t) get((std::size_t) ply * m_cell_bits,
+			m_cell_bits);
+		return Move{ n, n };
+	}
+	const std::size_t bit = (std::size_t) placements * m_cell_bits +
+		(std::size_t) (ply - placements) * (m_cell_bits + 2);
+	const int from = (int) get(bit, m_cell_bits);
+	const int steps[4] = { -m_dim, m_dim, -1, 1 };
+	const int to = from + steps[get(bit + m_cell_bits, 2)];
+	return Move{ (std::uint8_t) from, (std::uint8_t) to };
+}
+
+unsigned int RecordView::get(std::size_t bit, int bits) const
+{
+	unsigned int value = 0;
+	for (int b = 0; b < bits; ++b, ++bit)
+		value |= (unsigned int) (m_data[bit / 8] >> (bit % 8) & 1) << b;
+	return value;
+}
+
+RecordWriter::RecordWriter() :
+	m_offset(0),
+	m_games(0)
+{
+}
+
+RecordWriter::~RecordWriter()
+{
+	close();
+}
+
+bool RecordWriter::open(std::string const& path)
+{
+	close();
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_out.open(path, std::ios::binary | std::ios::trunc);
+	if (!m_out)
+		return false;
+	writeU32(m_out, MAGIC);
+	writeU32(m_out, VERSION);
+	writeU32(m_out, BLOCK_GAMES);
+	writeU32(m_out, 0);
+	m_offset = HEADER_SIZE;
+	m_games = 0;
+	m_index.clear();
+	return (bool) m_out;
+}
+
+bool RecordWriter::write(GameRecord const& record, Cell winner)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_out.is_open())
+		return false;
+	if (m_games % BLOCK_GAMES == 0)
+		m_index.push_back(m_offset);
+	m_out.put((char) record.getDimension());
+	m_out.put((char) record.getFirstPlayer());
+	m_out.put((char) winner);
+	m_out.put(0);
+	writeU32(m_out, (std::uint32_t) record.getPlyCount());
+	writeU32(m_out, record.getSeed());
+	writeU64(m_out, record.getNumber());
+	auto const& bytes = record.getBytes();
+	m_out.write((char const*) bytes.data(), (std::streamsize) bytes.size());
+	m_offset += GAME_HEADER_SIZE + bytes.size();
+	++m_games;
+	return (bool) m_out;
+}
+
+bool RecordWriter::close()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_out.is_open())
+		return true;
+	const std::uint64_t index_offset = m_offset;
+	for (std::uint64_t offset : m_index)
+		writeU64(m_out, offset);
+	writeU64(m_out, index_offset);
+	writeU64(m_out, m_games);
+	writeU32(m_out, MAGIC);
+	const bool ok = (bool) m_out;
+	m_out.close();
+	return ok && !m_out.fail();
+}
+
+std::uint64_t RecordWriter::getGameCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_games;
+}
+
+RecordReader::RecordReader() :
+	m_begin(HEADER_SIZE),
+	m_end(HEADER_SIZE),
+	m_games(0)
+{
+}
+
+bool RecordReader::open(std::string const& path)
+{
+	m_index.clear();
+	m_games = 0;
+	m_begin = m_end = HEADER_SIZE;
+	if (!m_file.open(path))
+		return false;
+	unsigned char const* data = m_file.getData();
+	const std::size_t size = m_file.getSize();
+	if (size < HEADER_SIZE || readLE(data, 4) != MAGIC ||
+		readLE(data + 4, 4) != VERSION ||
+		readLE(data + 8, 4) != RecordWriter::BLOCK_GAMES) {
+		m_file.close();
+		return false;
+	}
+
+	// Closed file: the index is at the end
+	if (size >= HEADER_SIZE + FOOTER_SIZE &&
+		readLE(data + size - 4, 4) == MAGIC) {
+		unsigned char const* footer = data + size - FOOTER_SIZE;
+		const std::uint64_t index_offset = readLE(footer, 8);
+		const std::uint64_t games = readLE(footer + 8, 8);
+		const std::uint64_t blocks =
+			(games + RecordWriter::BLOCK_GAMES - 1) / RecordWriter::BLOCK_GAMES;
+		if (index_offset >= HEADER_SIZE &&
+			index_offset + blocks * sizeof(std::uint64_t) == size - FOOTER_SIZE) {
+			for (std::uint64_t b = 0; b < blocks; ++b)
+				m_index.push_back(readLE(data + index_offset + b * sizeof(std::uint64_t), 8));
+			m_end = (std::size_t) index_offset;
+			m_games = games;
+			return true;
+		}
+	}
+
+	// Writer cut short: walk the whole games there are
+	m_end = size;
+	std::size_t offset = m_begin;
+	RecordView view;
+	for (std::size_t next = offset; parse(next, view); offset = next) {
+		if (m_games % RecordWriter::BLOCK_GAMES == 0)
+			m_index.push_back(offset);
+		++m_games;
+	}
+	m_end = offset;
+	return true;
+}
+
+bool RecordReader::isOpen() const
+{
+	return m_file.isOpen();
+}
+
+std::uint64_t RecordReader::getGameCount() const
+{
+	return m_games;
+}
+
+bool RecordReader::getGame(std::uint64_t n, RecordView& view) const
+{
+	if (n >= m_games)
+		return false;
+	std::size_t offset = (std::size_t) m_index[n / RecordWriter::BLOCK_GAMES];
+	for (std::uint64_t k = n % RecordWriter::BLOCK_GAMES; k > 0; --k)
+		if (!parse(offset, view))
+			return false;
+	return parse(offset, view);
+}
+
+bool RecordReader::parse(std::size_t& offset, RecordView& view) const
+{
+	if (offset > m_end || m_end - offset < GAME_HEADER_SIZE)
+		return false;
+	unsigned char const* data = m_file.getData() + offset;
+	const int dim = data[0];
+	if (dim < 2 || dim > BitBoard::MAX_DIM || !validCell(data[2]))
+		return false;
+	if (data[1] != (int) Cell::YELLOW && data[1] != (int) Cell::RED)
+		return false; // Someone has to move first
+	const std::uint64_t plies = readLE(data + 4, 4);
+	if (plies > (std::uint64_t) INT32_MAX)
+		return false;
+	const int cell_bits = GameRecord::cellBits(dim);
+	const std::size_t payload = payloadSize(dim, cell_bits, (int) plies);
+	if (m_end - offset - GAME_HEADER_SIZE < payload)
+		return false; // Truncated
+	view.m_data = data + GAME_HEADER_SIZE;
+	view.m_dim = dim;
+	view.m_cell_bits = cell_bits;
+	view.m_first = (Cell) data[1];
+	view.m_winner = (Cell) data[2];
+	view.m_seed = (std::uint32_t) readLE(data + 8, 4);
+	view.m_number = readLE(data + 12, 8);
+	view.m_plies = (int) plies;
+	offset += GAME_HEADER_SIZE + payload;
+	return true;
+}
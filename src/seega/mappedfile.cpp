@@ -0,0 +1,101 @@
+#include "mappedfile.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() :
+	m_data(nullptr),
+	m_size(0)
+#if defined(_WIN32)
+	, m_file(INVALID_HANDLE_VALUE),
+	m_mapping(nullptr)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+#if defined(_WIN32)
+
+bool MappedFile::open(std::string const& path)
+{
+	close();
+	m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0) {
+		close();
+		return false;
+	}
+	m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m_mapping) {
+		close();
+		return false;
+	}
+	m_data = (unsigned char const*) MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!m_data) {
+		close();
+		return false;
+	}
+	m_size = (std::size_t) size.QuadPart;
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (m_data)
+		UnmapViewOfFile(m_data);
+	if (m_mapping)
+		CloseHandle(m_mapping);
+	if (m_file != INVALID_HANDLE_VALUE)
+		CloseHandle(m_file);
+	m_data = nullptr;
+	m_size = 0;
+	m_mapping = nullptr;
+	m_file = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool MappedFile::open(std::string const& path)
+{
+	close();
+	const int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+	void* data = mmap(nullptr, (std::size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd); // The mapping keeps the file alive
+	if (data == MAP_FAILED)
+		return false;
+	m_data = (unsigned char const*) data;
+	m_size = (std::size_t) st.st_size;
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (m_data)
+		munmap((void*) m_data, m_size);
+	m_data = nullptr;
+	m_size = 0;
+}
+
+#endif
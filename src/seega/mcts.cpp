@@ -0,0 +1,387 @@
+#include "mcts.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "board.h"
+
+namespace
+{
+	constexpr std::uint32_t NONE = 0xFFFFFFFF;
+
+	// Plies below the last root searched for the new position
+	constexpr int REUSE_DEPTH = 4;
+
+	enum : std::uint8_t
+	{
+		UNEXPANDED,
+		EXPANDING,
+		EXPANDED,
+	};
+
+	bool make(Game& game, Move move, Game::Undo& undo)
+	{
+		if (move.from == move.to)
+			return game.makePlacement(move.to, undo);
+		return game.makeMove(move, undo);
+	}
+
+	void unmake(Game& game, Game::Undo const& undo)
+	{
+		if (undo.move.from == undo.move.to)
+			game.unmakePlacement(undo);
+		else
+			game.unmakeMove(undo);
+	}
+
+	// Playout results are yellow's share, from 0 (red won) to SCALE
+	constexpr std::uint32_t SCALE = 64;
+
+	std::uint32_t outcome(Cell winner)
+	{
+		if (winner == Cell::EMPTY)
+			return SCALE / 2;
+		return winner == Cell::YELLOW ? SCALE : 0;
+	}
+
+	std::uint32_t points(Cell player, std::uint32_t result)
+	{
+		return player == Cell::YELLOW ? result : SCALE - result;
+	}
+}
+
+struct Mcts::Node
+{
+	std::atomic<std::uint32_t> visits;
+	std::atomic<std::uint32_t> score; // sum of the results for `player`
+	std::atomic<std::uint8_t> state;
+	std::uint32_t first_child;        // valid once EXPANDED
+	std::uint32_t child_count;
+	Move move;
+	Cell player;                      // who made the move into this node
+	std::uint64_t hash;               // position after the move
+
+	void init(Move m, Cell p, std::uint64_t h)
+	{
+		visits.store(0, std::memory_order_relaxed);
+		score.store(0, std::memory_order_relaxed);
+		state.store(UNEXPANDED, std::memory_order_relaxed);
+		first_child = NONE;
+		child_count = 0;
+		move = m;
+		player = p;
+		hash = h;
+	}
+};
+
+struct Mcts::Worker
+{
+	Worker(Game const& root, unsigned int seed) :
+		game(root),
+		rng(seed)
+	{
+		undos.reserve(1024);
+		path.reserve(256);
+	}
+
+	Game game; // sits at the root between iterations
+	std::default_random_engine rng;
+	std::vector<Game::Undo> undos;
+	std::vector<std::uint32_t> path;
+	Move moves[Game::MAX_MOVES];
+};
+
+Mcts::Mcts(MctsOptions const& options) :
+	m_options(options),
+	m_nodes(new Node[options.max_nodes]),
+	m_used(0),
+	m_root(NONE),
+	m_searches(0),
+	m_playouts(0),
+	m_stop(false),
+	m_stop_flag(nullptr),
+	m_pondering(false)
+{
+	assert(options.max_nodes > 0 && options.max_nodes < NONE);
+	assert(options.time_ms > 0 || options.max_playouts > 0);
+	if (m_options.threads == 0)
+		m_options.threads = std::max(1u, std::thread::hardware_concurrency());
+}
+
+Mcts::~Mcts()
+{
+}
+
+MctsOptions const& Mcts::getOptions() const
+{
+	return m_options;
+}
+
+void Mcts::setTablebase(std::shared_ptr<Tablebase const> tablebase)
+{
+	m_tablebase = tablebase;
+}
+
+void Mcts::setStopFlag(std::atomic<bool> const* stop)
+{
+	m_stop_flag = stop;
+}
+
+void Mcts::reset(unsigned int seed)
+{
+	m_root = NONE;
+	m_used.store(0);
+	m_options.seed = seed;
+	m_searches = 0;
+}
+
+MctsResult Mcts::search(Game const& game)
+{
+	m_deadline = std::chrono::steady_clock::now() +
+		std::chrono::milliseconds(m_options.time_ms);
+	m_stop.store(false);
+	m_playouts.store(0);
+
+	// Keep the subtree of the new position if there is room to grow it
+	std::uint32_t root = NONE;
+	if (m_root != NONE && m_used.load() < m_options.max_nodes / 10 * 9)
+		root = find(m_root, game.getHash(), REUSE_DEPTH);
+	if (root == NONE) {
+		m_used.store(0);
+		root = allocate(1);
+		m_nodes[root].init(Move{ 0, 0 }, Cell::EMPTY, game.getHash());
+	}
+	m_root = root;
+
+	std::vector<std::thread> threads;
+	for (unsigned int t = 1; t < m_options.threads; ++t)
+		threads.emplace_back(&Mcts::work, this, std::cref(game), t);
+	work(game, 0);
+	for (auto& thread : threads)
+		thread.join();
+	++m_searches;
+
+	// Most visited move
+	Node const& node = m_nodes[m_root];
+	MctsResult result{ Move{ 0, 0 }, m_playouts.load(), m_used.load(), 0. };
+	if (node.state.load() != EXPANDED) {
+		// Arena too small to even expand the root
+		Move moves[Game::MAX_MOVES];
+		game.getLegalMoves(moves);
+		result.move = moves[0];
+	}
+	std::uint32_t best_visits = 0;
+	for (std::uint32_t c = 0; c < node.child_count; ++c) {
+		Node const& child = m_nodes[node.first_child + c];
+		const std::uint32_t visits = child.visits.load();
+		if (c == 0 || visits > best_visits) {
+			best_visits = visits;
+			result.move = child.move;
+			result.value = visits ? child.score.load() / ((double) SCALE * visits) : 0.;
+		}
+	}
+	result.nodes = std::min<std::size_t>(result.nodes, m_options.max_nodes);
+	return result;
+}
+
+Move Mcts::ponder(Game const& game)
+{
+	m_pondering = true;
+	const Move move = search(game).move;
+	m_pondering = false;
+	return move;
+}
+
+void Mcts::work(Game const& game, unsigned int thread)
+{
+	std::seed_seq seq{ m_options.seed, (unsigned int) m_searches, thread };
+	std::default_random_engine rng(seq);
+	Worker worker(game, rng());
+	worker.game.setVerbose(false);
+	do {
+		iterate(worker);
+		m_playouts.fetch_add(1, std::memory_order_relaxed);
+	} while (!shouldStop());
+	m_stop.store(true, std::memory_order_relaxed);
+}
+
+void Mcts::iterate(Worker& worker)
+{
+	Game& game = worker.game;
+	worker.path.clear();
+	worker.undos.clear();
+
+	// Selection and expansion
+	std::uint32_t n = m_root;
+	m_nodes[n].visits.fetch_add(1, std::memory_order_relaxed);
+	worker.path.push_back(n);
+	while (!game.isOver()) {
+		Node& node = m_nodes[n];
+		const bool is_root = n == m_root;
+		if (node.state.load(std::memory_order_acquire) != EXPANDED) {
+			// Leaves grow on their second visit, which halves the tree
+			if (!is_root && node.visits.load(std::memory_order_relaxed) < 2)
+				break;
+			if (!expand(node, game))
+				break;
+		}
+		Node& child = select(node);
+		// Virtual loss: the visit counts before the score comes back
+		child.visits.fetch_add(1, std::memory_order_relaxed);
+		worker.undos.emplace_back();
+		make(game, child.move, worker.undos.back());
+		n = (std::uint32_t) (&child - m_nodes.get());
+		worker.path.push_back(n);
+	}
+
+	// Simulation
+	const std::uint32_t result = game.isOver()
+		? outcome(game.getWinner()) : playout(worker);
+
+	// Backpropagation
+	for (std::uint32_t p : worker.path) {
+		Node& node = m_nodes[p];
+		node.score.fetch_add(points(node.player, result),
+			std::memory_order_relaxed);
+	}
+	for (auto it = worker.undos.rbegin(); it != worker.undos.rend(); ++it)
+		unmake(game, *it);
+}
+
+bool Mcts::expand(Node& node, Game& game)
+{
+	std::uint8_t state = UNEXPANDED;
+	if (!node.state.compare_exchange_strong(state, EXPANDING,
+		std::memory_order_acq_rel))
+		return state == EXPANDED;
+
+	Move moves[Game::MAX_MOVES];
+	const int count = game.getLegalMoves(moves);
+	const std::uint32_t first = count ? allocate(count) : NONE;
+	if (first == NONE) {
+		node.state.store(UNEXPANDED, std::memory_order_release);
+		return false; // Arena full, keep it a leaf
+	}
+	for (int i = 0; i < count; ++i) {
+		Game::Undo undo;
+		make(game, moves[i], undo);
+		m_nodes[first + i].init(moves[i], undo.turn, game.getHash());
+		unmake(game, undo);
+	}
+	node.first_child = first;
+	node.child_count = count;
+	node.state.store(EXPANDED, std::memory_order_release);
+	return true;
+}
+
+Mcts::Node& Mcts::select(Node const& node) const
+{
+	const double log_visits =
+		std::log((double) node.visits.load(std::memory_order_relaxed) + 1.);
+	Node* best = &m_nodes[node.first_child];
+	double best_value = -1.;
+	for (std::uint32_t c = 0; c < node.child_count; ++c) {
+		Node& child = m_nodes[node.first_child + c];
+		const std::uint32_t visits = child.visits.load(std::memory_order_relaxed);
+		if (visits == 0)
+			return child;
+		const double value =
+			child.score.load(std::memory_order_relaxed) / ((double) SCALE * visits) +
+			m_options.exploration * std::sqrt(log_visits / visits);
+		if (value > best_value) {
+			best_value = value;
+			best = &child;
+		}
+	}
+	return *best;
+}
+
+std::uint32_t Mcts::playout(Worker& worker)
+{
+	Game& game = worker.game;
+	BitBoard const& bits = game.getBits();
+	const int tb_pieces = m_tablebase ? m_tablebase->getMaxPieces() : 0;
+	for (int ply = 0; ply < m_options.max_playout_plies && !game.isOver(); ++ply) {
+		TBEntry entry;
+		if (bits.pieces(Cell::YELLOW).count() + bits.pieces(Cell::RED).count() <= tb_pieces &&
+			m_tablebase->probe(game, entry)) {
+			if (entry.result == TBResult::DRAW)
+				return SCALE / 2;
+			const bool yellow_wins = (game.getTurn() == Cell::YELLOW) ==
+				(entry.result == TBResult::WIN);
+			return yellow_wins ? SCALE : 0;
+		}
+		const int count = game.getLegalMoves(worker.moves);
+		if (count == 0)
+			break;
+		Move move = worker.moves[0];
+		if (game.getStage() == Game::Stage::PLAYING) {
+			// Capturing moves first, like the random AI
+			const BitMask targets = bits.captureTargets(game.getTurn());
+			int captures = 0;
+			for (int i = 0; i < count; ++i)
+				if (targets.test(worker.moves[i].to))
+					worker.moves[captures++] = worker.moves[i];
+			const int choices = captures ? captures : count;
+			move = worker.moves[std::uniform_int_distribution<int>(
+				0, choices - 1)(worker.rng)];
+		} else {
+			move = worker.moves[std::uniform_int_distribution<int>(
+				0, count - 1)(worker.rng)];
+		}
+		worker.undos.emplace_back();
+		make(game, move, worker.undos.back());
+	}
+	if (game.isOver())
+		return outcome(game.getWinner());
+
+	// Cut short: scored by the share of the material left
+	const std::uint32_t yellow = bits.pieces(Cell::YELLOW).count();
+	const std::uint32_t red = bits.pieces(Cell::RED).count();
+	if (yellow + red == 0)
+		return SCALE / 2;
+	return SCALE * yellow / (yellow + red);
+}
+
+std::uint32_t Mcts::allocate(std::uint32_t count)
+{
+	if (m_used.load(std::memory_order_relaxed) + count > m_options.max_nodes)
+		return NONE;
+	const std::uint32_t first = m_used.fetch_add(count, std::memory_order_relaxed);
+	if (first + count > m_options.max_nodes)
+		return NONE;
+	return first;
+}
+
+std::uint32_t Mcts::find(std::uint32_t n, std::uint64_t hash, int depth) const
+{
+	Node const& node = m_nodes[n];
+	if (node.hash == hash)
+		return n;
+	if (depth == 0 || node.state.load() != EXPANDED)
+		return NONE;
+	for (std::uint32_t c = 0; c < node.child_count; ++c) {
+		const std::uint32_t found = find(node.first_child + c, hash, depth - 1);
+		if (found != NONE)
+			return found;
+	}
+	return NONE;
+}
+
+bool Mcts::shouldStop() const
+{
+	if (m_stop.load(std::memory_order_relaxed))
+		return true;
+	if (m_stop_flag && m_stop_flag->load(std::memory_order_relaxed))
+		return true;
+	if (m_pondering) // Room left to grow the subtree that is kept
+		return m_used.load(std::memory_order_relaxed) >= m_options.max_nodes / 4 * 3;
+	if (m_options.max_playouts &&
+		m_playouts.load(std::memory_order_relaxed) >= m_options.max_playouts)
+		return true;
+	return m_options.time_ms &&
+		std::chrono::steady_clock::now() >= m_deadline;
+}
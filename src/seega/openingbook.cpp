@@ -0,0 +1,251 @@
+#include "openingbook.h"
+
+#include <algorithm>
+#include <fstream>
+#include <ostream>
+#include <vector>
+
+#include "board.h"
+#include "game.h"
+#include "gamerecord.h"
+#include "symmetry.h"
+
+namespace
+{
+	constexpr std::uint32_t MAGIC = 0x424F4753; // "SGOB"
+	constexpr std::uint32_t VERSION = 2;
+	constexpr std::size_t HEADER_SIZE = 4 * sizeof(std::uint32_t) + sizeof(std::uint64_t);
+	constexpr std::size_t ENTRY_SIZE = 20;
+
+	// One placement of one recorded game
+	struct Sample
+	{
+		std::uint64_t key;
+		std::uint8_t cell;
+		std::uint8_t points;
+
+		bool operator<(Sample const& other) const
+		{
+			return key != other.key ? key < other.key : cell < other.cell;
+		}
+	};
+
+	void writeU32(std::ostream& out, std::uint32_t value)
+	{
+		for (int b = 0; b < 4; ++b)
+			out.put((char) (value >> (8 * b)));
+	}
+
+	void writeU64(std::ostream& out, std::uint64_t value)
+	{
+		for (int b = 0; b < 8; ++b)
+			out.put((char) (value >> (8 * b)));
+	}
+
+	std::uint64_t readLE(unsigned char const* data, int bytes)
+	{
+		std::uint64_t value = 0;
+		for (int b = bytes - 1; b >= 0; --b)
+			value = (value << 8) | data[b];
+		return value;
+	}
+
+	// Share of points with one win and one loss more, in 1/65536ths
+	std::uint64_t smoothedScore(BookMove const& move)
+	{
+		return ((std::uint64_t) move.points + 2) * 65536 / (2 * (std::uint64_t) move.games + 4);
+	}
+}
+
+OpeningBook::OpeningBook() :
+	m_dim(0),
+	m_entries(0),
+	m_min_games(DEFAULT_MIN_GAMES)
+{
+}
+
+bool OpeningBook::open(std::string const& path)
+{
+	m_dim = 0;
+	m_entries = 0;
+	if (!m_file.open(path))
+		return false;
+	unsigned char const* data = m_file.getData();
+	const std::size_t size = m_file.getSize();
+	if (size < HEADER_SIZE || readLE(data, 4) != MAGIC || readLE(data + 4, 4) != VERSION) {
+		m_file.close();
+		return false;
+	}
+	const int dim = (int) readLE(data + 8, 4);
+	const std::uint64_t entries = readLE(data + 16, 8);
+	if (dim < 2 || dim > BitBoard::MAX_DIM ||
+		entries > (size - HEADER_SIZE) / ENTRY_SIZE) {
+		m_file.close();
+		return false; // Truncated file
+	}
+	// The binary search needs the order, and probe() one entry per cell
+	unsigned char const* entry = data + HEADER_SIZE;
+	for (std::uint64_t e = 1; e < entries; ++e, entry += ENTRY_SIZE) {
+		const std::uint64_t key = readLE(entry, 8);
+		const std::uint64_t next = readLE(entry + ENTRY_SIZE, 8);
+		if (next < key || (next == key && entry[ENTRY_SIZE + 8] <= entry[8])) {
+			m_file.close();
+			return false;
+		}
+	}
+	m_dim = dim;
+	m_entries = entries;
+	return true;
+}
+
+bool OpeningBook::isOpen() const
+{
+	return m_file.isOpen();
+}
+
+int OpeningBook::getDimension() const
+{
+	return m_dim;
+}
+
+std::uint64_t OpeningBook::getEntryCount() const
+{
+	return m_entries;
+}
+
+void OpeningBook::setMinGames(unsigned int min_games)
+{
+	m_min_games = min_games;
+}
+
+std::uint64_t OpeningBook::lowerBound(std::uint64_t key) const
+{
+	unsigned char const* entries = m_file.getData() + HEADER_SIZE;
+	std::uint64_t first = 0, count = m_entries;
+	while (count > 0) {
+		const std::uint64_t half = count / 2;
+		if (readLE(entries + (first + half) * ENTRY_SIZE, 8) < key) {
+			first += half + 1;
+			count -= half + 1;
+		} else {
+			count = half;
+		}
+	}
+	return first;
+}
+
+int OpeningBook::probe(std::uint64_t key, BookMove* moves, int capacity) const
+{
+	if (!isOpen())
+		return 0;
+	unsigned char const* entries = m_file.getData() + HEADER_SIZE;
+	int count = 0;
+	for (std::uint64_t e = lowerBound(key); e < m_entries && count < capacity; ++e) {
+		unsigned char const* entry = entries + e * ENTRY_SIZE;
+		if (readLE(entry, 8) != key)
+			break;
+		moves[count++] = BookMove{ entry[8],
+			(std::uint32_t) readLE(entry + 12, 4), (std::uint32_t) readLE(entry + 16, 4) };
+	}
+	return count;
+}
+
+bool OpeningBook::chooseMove(Game const& game, Move& move) const
+{
+	BitBoard const& bits = game.getBits();
+	if (game.getStage() != Game::Stage::PLACING_PIECES || bits.getDimension() != m_dim)
+		return false;
+	int transform;
+	const std::uint64_t key = game.getCanonicalHash(transform);
+	const int back = symmetry::inverse(transform);
+	BookMove moves[Game::MAX_MOVES];
+	const int count = probe(key, moves, Game::MAX_MOVES);
+	int best = -1;
+	std::uint64_t best_score = 0;
+	const BitMask free = bits.empty() & ~bits.center();
+	for (int k = 0; k < count; ++k) {
+		// A hash collision could suggest any cell
+		if (moves[k].games < m_min_games || moves[k].cell >= m_dim * m_dim)
+			continue;
+		moves[k].cell = symmetry::mapCell(moves[k].cell, back, m_dim);
+		if (!free.test(moves[k].cell))
+			continue;
+		const std::uint64_t score = smoothedScore(moves[k]);
+		if (best < 0 || score > best_score) {
+			best = k;
+			best_score = score;
+		}
+	}
+	if (best < 0)
+		return false;
+	move = Move{ (std::uint8_t) moves[best].cell, (std::uint8_t) moves[best].cell };
+	return true;
+}
+
+bool OpeningBook::build(RecordReader const& records, int dim, int max_plies,
+	unsigned int min_games, std::string const& path, std::ostream& log)
+{
+	if (dim < 2 || dim > BitBoard::MAX_DIM)
+		return false;
+	const int placements = dim * dim - 1;
+	max_plies = std::min(max_plies, placements);
+
+	std::vector<Sample> samples;
+	std::uint64_t games = 0;
+	records.forEachGame([&](RecordView const& view) {
+		if (view.getDimension() != dim)
+			return;
+		++games;
+		const Cell winner = view.getWinner();
+		Game game(dim, view.getFirstPlayer());
+		for (int ply = 0; ply < max_plies && ply < view.getPlyCount(); ++ply) {
+			const Move move = view.getMove(ply);
+			int transform;
+			const std::uint64_t key = game.getCanonicalHash(transform);
+			const Cell turn = game.getTurn();
+			if (move.from != move.to ||
+				!game.placePiece(move.to / dim, move.to % dim))
+				break; // Not a legal placement
+			// Unfinished games count as draws
+			const std::uint8_t points = winner == turn ? 2 : winner == Cell::EMPTY ? 1 : 0;
+			samples.push_back(Sample{ key,
+				(std::uint8_t) symmetry::mapCell(move.to, transform, dim), points });
+		}
+	});
+	log << games << " games, " << samples.size() << " placements" << std::endl;
+
+	std::sort(samples.begin(), samples.end());
+	std::vector<std::pair<Sample, BookMove>> entries;
+	for (std::size_t s = 0; s < samples.size(); ) {
+		BookMove stats{ samples[s].cell, 0, 0 };
+		std::size_t t = s;
+		for (; t < samples.size() && samples[t].key == samples[s].key &&
+			samples[t].cell == samples[s].cell; ++t) {
+			++stats.games;
+			stats.points += samples[t].points;
+		}
+		if (stats.games >= min_games)
+			entries.push_back(std::make_pair(samples[s], stats));
+		s = t;
+	}
+	log << entries.size() << " entries played at least " << min_games
+	    << " times" << std::endl;
+
+	std::ofstream out(path, std::ios::binary);
+	if (!out)
+		return false;
+	writeU32(out, MAGIC);
+	writeU32(out, VERSION);
+	writeU32(out, (std::uint32_t) dim);
+	writeU32(out, 0);
+	writeU64(out, entries.size());
+	for (auto const& [sample, stats] : entries) {
+		writeU64(out, sample.key);
+		out.put((char) sample.cell);
+		for (int b = 0; b < 3; ++b)
+			out.put(0);
+		writeU32(out, stats.games);
+		writeU32(out, stats.points);
+	}
+	return (bool) out;
+}
@@ -0,0 +1,134 @@
+#include "placementsampler.h"
+
+#include "board.h"
+
+namespace
+{
+	// Cells n and above
+	BitMask cellsFrom(int n)
+	{
+		return n < 64 ? BitMask(~std::uint64_t(0) << n, ~std::uint64_t(0))
+		              : BitMask(0, ~std::uint64_t(0) << (n - 64));
+	}
+}
+
+PlacementSampler::PlacementSampler(int dim) :
+	m_dim(dim),
+	m_top(1),
+	m_tree(dim * dim + 1, Moments{ 0, 0, 0, 0 }),
+	m_pieces{ 0, 0 },
+	m_sum_i{ 0, 0 },
+	m_sum_j{ 0, 0 }
+{
+	const int cells = dim * dim;
+	while (2 * m_top <= cells)
+		m_top *= 2;
+	// Every cell but the central one is free: the tree built in O(n)
+	for (int k = 1; k <= cells; ++k) {
+		const int i = (k - 1) / dim, j = (k - 1) % dim;
+		if (i != dim / 2 || j != dim / 2) {
+			Moments& m = m_tree[k];
+			m.count += 1;
+			m.i += i;
+			m.j += j;
+			m.squares += i * i + j * j;
+		}
+		const int parent = k + (k & -k);
+		if (parent <= cells) {
+			m_tree[parent].count += m_tree[k].count;
+			m_tree[parent].i += m_tree[k].i;
+			m_tree[parent].j += m_tree[k].j;
+			m_tree[parent].squares += m_tree[k].squares;
+		}
+	}
+}
+
+void PlacementSampler::place(int n, Cell player)
+{
+	const int p = (int) player - 1;
+	++m_pieces[p];
+	m_sum_i[p] += n / m_dim;
+	m_sum_j[p] += n % m_dim;
+	add(n, -1);
+}
+
+void PlacementSampler::unplace(int n, Cell player)
+{
+	const int p = (int) player - 1;
+	--m_pieces[p];
+	m_sum_i[p] -= n / m_dim;
+	m_sum_j[p] -= n % m_dim;
+	add(n, 1);
+}
+
+void PlacementSampler::add(int n, int sign)
+{
+	const int i = n / m_dim, j = n % m_dim;
+	const int cells = m_dim * m_dim;
+	for (int k = n + 1; k <= cells; k += k & -k) {
+		Moments& m = m_tree[k];
+		m.count += sign;
+		m.i += sign * i;
+		m.j += sign * j;
+		m.squares += sign * (i * i + j * j);
+	}
+}
+
+int PlacementSampler::sample(Cell player, BitMask free, float u) const
+{
+	const BitMask rest = free & cellsFrom(findFirst(player, u));
+	return rest.any() ? rest.lowest() : free.highest();
+}
+
+int PlacementSampler::sample(Cell player, Cell const* cells, float u) const
+{
+	const int center = m_dim / 2 * m_dim + m_dim / 2;
+	auto isFree = [&](int n) { return cells[n] == Cell::EMPTY && n != center; };
+	const int count = m_dim * m_dim;
+	for (int n = findFirst(player, u); n < count; ++n)
+		if (isFree(n))
+			return n;
+	int n = count - 1;
+	while (n > 0 && !isFree(n))
+		--n;
+	return n;
+}
+
+int PlacementSampler::findFirst(Cell player, float u) const
+{
+	// Distances scaled by s, from the centroid (a / s, b / s)
+	const int p = (int) player - 1;
+	const std::int64_t s = m_pieces[p] ? m_pieces[p] : 2;
+	const std::int64_t a = m_pieces[p] ? m_sum_i[p] : m_dim;
+	const std::int64_t b = m_pieces[p] ? m_sum_j[p] : m_dim;
+	auto weight = [&](Moments const& m) {
+		return s * s * m.squares - 2 * s * (a * m.i + b * m.j) + m.count * (a * a + b * b);
+	};
+
+	const int cells = m_dim * m_dim;
+	std::int64_t total = 0;
+	for (int k = cells; k > 0; k -= k & -k)
+		total += weight(m_tree[k]);
+
+	// As the roulette scan this replaced did, so that seeded games play
+	// the same: the first free cell with the cells before it weighing u
+	// (less a tolerance) of the total, the last one if none does
+	const double target = ((double) u - 1e-6) * (double) total;
+	int first = 0;
+	if (target > 0.) {
+		// Most leading cells weighing less than the target
+		int q = 0;
+		std::int64_t below = 0;
+		for (int step = m_top; step > 0; step /= 2) {
+			if (q + step > cells)
+				continue;
+			const std::int64_t w = below + weight(m_tree[q + step]);
+			if ((double) w < target) {
+				q += step;
+				below = w;
+			}
+		}
+		first = q + 1;
+	}
+	return first;
+}
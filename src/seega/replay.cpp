@@ -0,0 +1,65 @@
+#include "replay.h"
+
+#include <algorithm>
+
+#include "board.h"
+#include "gamerecord.h"
+
+Replay::Replay(int interval) :
+	m_interval(std::max(1, interval)),
+	m_ply(0)
+{
+}
+
+bool Replay::load(RecordView const& view)
+{
+	std::vector<Move> moves(view.getPlyCount());
+	for (int p = 0; p < view.getPlyCount(); ++p)
+		moves[p] = view.getMove(p);
+	return load(view.getDimension(), view.getFirstPlayer(), moves);
+}
+
+bool Replay::load(int dim, Cell first, std::vector<Move> const& moves)
+{
+	m_moves.clear();
+	m_snapshots.clear();
+	Game game(dim, first);
+	bool legal = true;
+	for (Move move : moves) {
+		if (m_snapshots.size() <= m_moves.size() / m_interval)
+			m_snapshots.push_back(game);
+		if (!play(game, move)) {
+			legal = false;
+			break;
+		}
+		m_moves.push_back(move);
+	}
+	if (m_snapshots.size() <= m_moves.size() / m_interval)
+		m_snapshots.push_back(game);
+	m_game = std::make_unique<Game>(game);
+	m_ply = (int) m_moves.size();
+	return legal;
+}
+
+Game const& Replay::seek(int ply)
+{
+	ply = std::clamp(ply, 0, getPlyCount());
+	const int base = ply / m_interval * m_interval;
+	// Forward from the current position when no snapshot is closer
+	if (ply < m_ply || m_ply < base) {
+		m_game = std::make_unique<Game>(m_snapshots[ply / m_interval]);
+		m_ply = base;
+	}
+	for (; m_ply < ply; ++m_ply)
+		play(*m_game, m_moves[m_ply]);
+	return *m_game;
+}
+
+bool Replay::play(Game& game, Move move) const
+{
+	const int dim = game.getBoard()->getDimension();
+	if (move.from == move.to)
+		return game.placePiece(move.to / dim, move.to % dim);
+	return game.movePiece(move.from / dim, move.from % dim,
+		move.to / dim, move.to % dim);
+}
@@ -0,0 +1,113 @@
+#include "selfplay.h"
+
+#include <memory>
+
+#include "game.h"
+#include "board.h"
+#include "workstealing.h"
+
+void SelfPlayStats::record(Game const& game)
+{
+	++games;
+	plies += game.getPlyCount();
+	switch (game.getWinner()) {
+	case Cell::YELLOW:
+		++yellow_wins;
+		break;
+	case Cell::RED:
+		++red_wins;
+		break;
+	default:
+		++draws;
+		break;
+	}
+}
+
+SelfPlayStats& SelfPlayStats::operator+=(SelfPlayStats const& other)
+{
+	games += other.games;
+	plies += other.plies;
+	yellow_wins += other.yellow_wins;
+	red_wins += other.red_wins;
+	draws += other.draws;
+	search += other.search;
+	return *this;
+}
+
+void seedSelfPlayEngine(std::default_random_engine& rng, unsigned int seed,
+	unsigned long long n)
+{
+	std::seed_seq seq{ seed, (unsigned int) n, (unsigned int) (n >> 32) };
+	rng.seed(seq);
+}
+
+SelfPlayEngines SelfPlayEngines::create(SelfPlayOptions const& options)
+{
+	AgentRegistry const& registry = AgentRegistry::instance();
+	SelfPlayEngines engines;
+	engines.agents[0] = registry.create(options.agents[0], options.agent);
+	engines.agents[1] = options.agents[1] == options.agents[0]
+		? engines.agents[0] : registry.create(options.agents[1], options.agent);
+	return engines;
+}
+
+Cell playSelfGame(SelfPlayOptions const& options, unsigned long long n,
+	std::default_random_engine& rng, SelfPlayEngines const& engines,
+	SelfPlayStats& stats)
+{
+	seedSelfPlayEngine(rng, options.seed, n);
+	Game game(options.board_size, true, rng);
+	game.setVerbose(false);
+	game.setTablebase(options.agent.tablebase);
+	game.setOpeningBook(options.book);
+	for (int p = 0; p < 2; ++p) {
+		if (p == 0 || engines.agents[1] != engines.agents[0])
+			engines.agents[p]->newGame(rng);
+		game.setAgent((Cell) (p + 1), engines.agents[p]);
+	}
+	std::shared_ptr<GameRecord> record;
+	if (options.record) {
+		record = std::make_shared<GameRecord>();
+		record->setOrigin(options.seed, n);
+		game.setRecord(record);
+	}
+	while (!game.isOver() && game.getPlyCount() < options.max_plies)
+		if (!game.autoPlay())
+			break; // No legal action left
+	stats.record(game);
+	if (record)
+		options.record->write(*record, game.getWinner());
+	return game.getWinner();
+}
+
+namespace
+{
+	// Padded so that workers never share a cache line
+	struct alignas(64) Worker
+	{
+		std::default_random_engine rng;
+		SelfPlayEngines engines;
+		SelfPlayStats stats;
+	};
+}
+
+SelfPlayStats runSelfPlay(SelfPlayOptions const& options)
+{
+	WorkStealingRunner runner(options.threads);
+	std::unique_ptr<Worker[]> workers(new Worker[runner.getThreadCount()]);
+	for (unsigned int w = 0; w < runner.getThreadCount(); ++w)
+		workers[w].engines = SelfPlayEngines::create(options);
+	runner.run(options.games, [&](unsigned int w, unsigned long long n) {
+		playSelfGame(options, n, workers[w].rng, workers[w].engines,
+			workers[w].stats);
+	});
+	SelfPlayStats stats;
+	for (unsigned int w = 0; w < runner.getThreadCount(); ++w) {
+		SelfPlayEngines const& engines = workers[w].engines;
+		stats += workers[w].stats;
+		stats.search += engines.agents[0]->getSearchTotals();
+		if (engines.agents[1] != engines.agents[0])
+			stats.search += engines.agents[1]->getSearchTotals();
+	}
+	return stats;
+}
@@ -0,0 +1,182 @@
+#include "symmetry.h"
+
+#include <array>
+#include <cassert>
+
+#include "board.h"
+#include "game.h"
+#include "zobrist.h"
+
+namespace
+{
+	// Shifts by any amount below 128, unlike the operators of BitMask
+	BitMask shiftLeft(BitMask m, int n)
+	{
+		if (n == 0)
+			return m;
+		if (n >= 64)
+			return BitMask(0, m.lo << (n - 64));
+		return m << n;
+	}
+
+	BitMask shiftRight(BitMask m, int n)
+	{
+		if (n == 0)
+			return m;
+		if (n >= 64)
+			return BitMask(m.hi >> (n - 64), 0);
+		return m >> n;
+	}
+
+	// Exchanges the bits of the mask at positions p and p + shift
+	BitMask deltaSwap(BitMask m, BitMask low, int shift)
+	{
+		const BitMask t = (shiftRight(m, shift) ^ m) & low;
+		return m ^ t ^ shiftLeft(t, shift);
+	}
+
+	// Masks of the swaps for one board size
+	struct Swaps
+	{
+		int dim;
+		BitMask row[BitBoard::MAX_DIM]; // row i, for i < dim / 2
+		BitMask column[BitBoard::MAX_DIM]; // column j, for j < dim / 2
+		BitMask diagonal[BitBoard::MAX_DIM]; // cells with j - i = k, for k > 0
+
+		explicit Swaps(int d) :
+			dim(d)
+		{
+			for (int i = 0; i < d; ++i)
+				for (int j = 0; j < d; ++j) {
+					if (i < d / 2)
+						row[i] |= BitMask::bit(i * d + j);
+					if (j < d / 2)
+						column[j] |= BitMask::bit(i * d + j);
+					if (j > i)
+						diagonal[j - i] |= BitMask::bit(i * d + j);
+				}
+		}
+	};
+
+	Swaps const& swaps(int dim)
+	{
+		static const std::array<Swaps, BitBoard::MAX_DIM + 1> table{ Swaps(0),
+			Swaps(1), Swaps(2), Swaps(3), Swaps(4), Swaps(5), Swaps(6),
+			Swaps(7), Swaps(8), Swaps(9), Swaps(10), Swaps(11) };
+		assert(dim > 0 && dim <= BitBoard::MAX_DIM);
+		return table[dim];
+	}
+
+	// Column j to column dim - 1 - j
+	BitMask mirrorColumns(BitMask m, Swaps const& s)
+	{
+		for (int j = 0; j < s.dim / 2; ++j)
+			m = deltaSwap(m, s.column[j], s.dim - 1 - 2 * j);
+		return m;
+	}
+
+	// Row i to row dim - 1 - i
+	BitMask mirrorRows(BitMask m, Swaps const& s)
+	{
+		for (int i = 0; i < s.dim / 2; ++i)
+			m = deltaSwap(m, s.row[i], (s.dim - 1 - 2 * i) * s.dim);
+		return m;
+	}
+
+	// Cell (i, j) to cell (j, i), one diagonal at a time
+	BitMask transpose(BitMask m, Swaps const& s)
+	{
+		for (int k = 1; k < s.dim; ++k)
+			m = deltaSwap(m, s.diagonal[k], k * (s.dim - 1));
+		return m;
+	}
+
+	bool less(BitMask a_yellow, BitMask a_red, BitMask b_yellow, BitMask b_red)
+	{
+		if (a_yellow.hi != b_yellow.hi)
+			return a_yellow.hi < b_yellow.hi;
+		if (a_yellow.lo != b_yellow.lo)
+			return a_yellow.lo < b_yellow.lo;
+		if (a_red.hi != b_red.hi)
+			return a_red.hi < b_red.hi;
+		return a_red.lo < b_red.lo;
+	}
+}
+
+BitMask symmetry::apply(BitMask mask, int t, int dim)
+{
+	Swaps const& s = swaps(dim);
+	if (t & 4)
+		mask = transpose(mask, s);
+	if (t & 1)
+		mask = mirrorColumns(mask, s);
+	if (t & 2)
+		mask = mirrorRows(mask, s);
+	return mask;
+}
+
+void symmetry::applyAll(BitMask mask, int dim, BitMask* images)
+{
+	Swaps const& s = swaps(dim);
+	images[0] = mask;
+	images[4] = transpose(mask, s);
+	for (int t = 0; t < COUNT; t += 4) {
+		images[t + 1] = mirrorColumns(images[t], s);
+		images[t + 2] = mirrorRows(images[t], s);
+		images[t + 3] = mirrorRows(images[t + 1], s);
+	}
+}
+
+int symmetry::mapCell(int n, int t, int dim)
+{
+	int i = n / dim, j = n % dim;
+	if (t & 4) {
+		const int k = i;
+		i = j;
+		j = k;
+	}
+	if (t & 1)
+		j = dim - 1 - j;
+	if (t & 2)
+		i = dim - 1 - i;
+	return i * dim + j;
+}
+
+Move symmetry::mapMove(Move move, int t, int dim)
+{
+	return Move{ (std::uint8_t) mapCell(move.from, t, dim),
+		(std::uint8_t) mapCell(move.to, t, dim) };
+}
+
+int symmetry::inverse(int t)
+{
+	// Mirroring after a transposition is transposing after the other
+	// mirror, so the inverse of those swaps the two mirror bits
+	if (t & 4)
+		return 4 | ((t & 1) << 1) | ((t & 2) >> 1);
+	return t;
+}
+
+symmetry::Canonical symmetry::canonicalize(BitMask yellow, BitMask red, int dim)
+{
+	BitMask yellows[COUNT], reds[COUNT];
+	applyAll(yellow, dim, yellows);
+	applyAll(red, dim, reds);
+	// On even boards the special center cell (dim / 2, dim / 2) is off the
+	// middle, and only the transposition keeps it in place
+	const int step = dim % 2 == 0 ? 4 : 1;
+	int best = 0;
+	for (int t = step; t < COUNT; t += step)
+		if (less(yellows[t], reds[t], yellows[best], reds[best]))
+			best = t;
+	return Canonical{ yellows[best], reds[best], best };
+}
+
+std::uint64_t symmetry::canonicalHash(BitBoard const& bits, Cell turn,
+	bool half_turn, int& transform)
+{
+	const Canonical c = canonicalize(bits.pieces(Cell::YELLOW),
+		bits.pieces(Cell::RED), bits.getDimension());
+	transform = c.transform;
+	return zobrist::hash(c.yellow, c.red, turn, half_turn);
+}
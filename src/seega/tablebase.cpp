@@ -0,0 +1,573 @@
+#include "tablebase.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <ostream>
+
+#include "board.h"
+#include "game.h"
+
+namespace
+{
+	constexpr std::uint32_t MAGIC = 0x42544753; // "SGTB"
+	constexpr std::uint32_t VERSION = 1;
+	constexpr std::size_t HEADER_SIZE = 4 * sizeof(std::uint32_t);
+	constexpr int MAX_CELLS = BitBoard::MAX_DIM * BitBoard::MAX_DIM;
+
+	constexpr std::uint8_t LOSS_BIT = 0x80;
+
+	// Pascal's triangle up to the largest board
+	struct Binomials
+	{
+		std::uint64_t c[MAX_CELLS + 1][Tablebase::MAX_PIECES + 1];
+
+		Binomials()
+		{
+			for (int n = 0; n <= MAX_CELLS; ++n) {
+				c[n][0] = 1;
+				for (int k = 1; k <= Tablebase::MAX_PIECES; ++k)
+					c[n][k] = n == 0 ? 0 : c[n - 1][k - 1] + c[n - 1][k];
+			}
+		}
+	};
+
+	std::uint64_t binomial(int n, int k)
+	{
+		static const Binomials table;
+		return table.c[n][k];
+	}
+
+	// Classes are ordered by yellow count, then red count
+	int classIndex(int yellow, int red, int max_pieces)
+	{
+		int index = 0;
+		for (int y = 1; y < yellow; ++y)
+			index += max_pieces - y;
+		return index + red - 1;
+	}
+
+	int classCount(int max_pieces)
+	{
+		return max_pieces * (max_pieces - 1) / 2;
+	}
+
+	std::uint64_t classSize(int cells, int yellow, int red)
+	{
+		return binomial(cells, yellow) * binomial(cells - yellow, red) * 2;
+	}
+
+	// Pieces of the mask lying on cells below c
+	int countBelow(BitMask mask, int c)
+	{
+		const std::uint64_t lo = c >= 64 ? ~std::uint64_t(0)
+			: (std::uint64_t(1) << c) - 1;
+		const std::uint64_t hi = c <= 64 ? 0
+			: (std::uint64_t(1) << (c - 64)) - 1;
+		return (mask & BitMask(lo, hi)).count();
+	}
+
+	// Colexicographic rank of the set of cells among the combinations
+	// of its size; red cells are first renumbered over the cells that
+	// are not yellow
+	std::uint64_t rank(int cells, BitMask yellow, BitMask red, Cell turn)
+	{
+		std::uint64_t yellow_rank = 0, red_rank = 0;
+		int k = 1;
+		for (BitMask m = yellow; m.any(); ++k)
+			yellow_rank += binomial(m.pop(), k);
+		k = 1;
+		for (BitMask m = red; m.any(); ++k) {
+			const int c = m.pop();
+			red_rank += binomial(c - countBelow(yellow, c), k);
+		}
+		const int red_count = red.count();
+		return (yellow_rank * binomial(cells - yellow.count(), red_count)
+			+ red_rank) * 2 + (turn == Cell::RED ? 1 : 0);
+	}
+
+	// Cells of the k-combination of the given rank, in decreasing order
+	void unrankSet(std::uint64_t r, int k, int cells, int* out)
+	{
+		int c = cells - 1;
+		for (; k > 0; --k) {
+			while (binomial(c, k) > r)
+				--c;
+			r -= binomial(c, k);
+			*out++ = c--;
+		}
+	}
+
+	void unrank(int cells, int yellow_count, int red_count, std::uint64_t index,
+		BitMask& yellow, BitMask& red, Cell& turn)
+	{
+		turn = (index & 1) ? Cell::RED : Cell::YELLOW;
+		index >>= 1;
+		const std::uint64_t red_size = binomial(cells - yellow_count, red_count);
+		int set[Tablebase::MAX_PIECES];
+		yellow = red = BitMask();
+		unrankSet(index / red_size, yellow_count, cells, set);
+		for (int k = 0; k < yellow_count; ++k)
+			yellow |= BitMask::bit(set[k]);
+		unrankSet(index % red_size, red_count, cells - yellow_count, set);
+		// Back from the numbering over the cells that are not yellow
+		int free_cells[MAX_CELLS];
+		int free_count = 0;
+		for (int c = 0; c < cells; ++c)
+			if (!yellow.test(c))
+				free_cells[free_count++] = c;
+		for (int k = 0; k < red_count; ++k)
+			red |= BitMask::bit(free_cells[set[k]]);
+	}
+
+	std::uint8_t encode(TBEntry entry)
+	{
+		const int distance = std::min(entry.distance, Tablebase::MAX_DISTANCE);
+		switch (entry.result) {
+		case TBResult::WIN:
+			return (std::uint8_t) distance;
+		case TBResult::LOSS:
+			return (std::uint8_t) (LOSS_BIT | distance);
+		default:
+			return 0;
+		}
+	}
+
+	TBEntry decode(std::uint8_t value)
+	{
+		if (value == 0)
+			return TBEntry{ TBResult::DRAW, 0 };
+		if (value & LOSS_BIT)
+			return TBEntry{ TBResult::LOSS, value & Tablebase::MAX_DISTANCE };
+		return TBEntry{ TBResult::WIN, value };
+	}
+
+	// Orders entries from the point of view of the player they belong to
+	int preference(TBEntry entry)
+	{
+		switch (entry.result) {
+		case TBResult::WIN:
+			return 1000 - entry.distance;
+		case TBResult::LOSS:
+			return -1000 + entry.distance;
+		default:
+			return 0;
+		}
+	}
+
+	TBEntry flip(TBEntry entry)
+	{
+		if (entry.result == TBResult::WIN)
+			entry.result = TBResult::LOSS;
+		else if (entry.result == TBResult::LOSS)
+			entry.result = TBResult::WIN;
+		return entry;
+	}
+
+	void writeU32(std::ostream& out, std::uint32_t value)
+	{
+		for (int b = 0; b < 4; ++b)
+			out.put((char) (value >> (8 * b)));
+	}
+
+	void writeU64(std::ostream& out, std::uint64_t value)
+	{
+		for (int b = 0; b < 8; ++b)
+			out.put((char) (value >> (8 * b)));
+	}
+
+	std::uint64_t readLE(unsigned char const* data, int bytes)
+	{
+		std::uint64_t value = 0;
+		for (int b = bytes - 1; b >= 0; --b)
+			value = (value << 8) | data[b];
+		return value;
+	}
+
+	// Retrograde analysis of one class at a time. Positions are solved in
+	// layers: layer d settles the wins and losses in exactly d plies, so
+	// the first layer a position is settled at is its distance. Only the
+	// positions that may have changed are looked at again: the ones a
+	// position settled in the previous layer can be reached from, and the
+	// ones whose captures lead to a smaller class settled at that distance.
+	class Builder
+	{
+	public:
+		Builder(int dim, int max_pieces, std::ostream& log) :
+			m_bits(dim),
+			m_cells(dim * dim),
+			m_max_pieces(max_pieces),
+			m_tables(classCount(max_pieces)),
+			m_log(log)
+		{
+		}
+
+		void run()
+		{
+			for (int total = 2; total <= m_max_pieces; ++total)
+				for (int y = 1; y < total; ++y)
+					buildClass(y, total - y);
+		}
+
+		std::vector<std::uint8_t> const& getTable(int c) const
+		{
+			return m_tables[c];
+		}
+	private:
+		static constexpr std::uint8_t NEVER = 0xFF;
+		static constexpr std::uint16_t CURRENT_LOSS = 0x8000;
+
+		// Value of the child after the move, from the mover's side. The
+		// distance is the child's; not known yet in the current class
+		// comes back as false.
+		bool child(BitMask yellow, BitMask red, Cell mover, int from, int to,
+			TBEntry& entry)
+		{
+			BitMask& own = mover == Cell::YELLOW ? yellow : red;
+			BitMask& enemy = mover == Cell::YELLOW ? red : yellow;
+			own ^= BitMask::bit(from) | BitMask::bit(to);
+			m_bits.setPieces(yellow, red);
+			enemy &= ~m_bits.captures(to, mover);
+			if (!enemy.any()) {
+				entry = TBEntry{ TBResult::WIN, 0 };
+				return true;
+			}
+			m_bits.setPieces(yellow, red);
+			const Cell other = mover == Cell::YELLOW ? Cell::RED : Cell::YELLOW;
+			const Cell next = m_bits.hasMove(other) ? other : mover;
+			const int y = yellow.count(), r = red.count();
+			const std::uint64_t index = rank(m_cells, yellow, red, next);
+			if (y == m_yellow && r == m_red) {
+				const std::uint16_t value = m_current[index];
+				if (value == 0)
+					return false;
+				entry = TBEntry{ value & CURRENT_LOSS ? TBResult::LOSS : TBResult::WIN,
+					value & ~CURRENT_LOSS };
+			} else {
+				entry = decode(m_tables[classIndex(y, r, m_max_pieces)][index]);
+			}
+			if (next != mover)
+				entry = flip(entry);
+			return true;
+		}
+
+		void buildClass(int yellow_count, int red_count)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			m_yellow = yellow_count;
+			m_red = red_count;
+			const std::uint64_t size = classSize(m_cells, yellow_count, red_count);
+			m_current.assign(size, 0);
+			std::vector<std::uint8_t> win_wake(size, NEVER), loss_wake(size, NEVER);
+			std::vector<std::uint8_t> marked(size, 0), next_marked(size, 0);
+
+			// Captures into smaller classes tell when to look again
+			int last_wake = 0;
+			for (std::uint64_t index = 0; index < size; ++index) {
+				BitMask yellow, red;
+				Cell turn;
+				unrank(m_cells, yellow_count, red_count, index, yellow, red, turn);
+				Move moves[Game::MAX_MOVES];
+				const int count = captureMoves(yellow, red, turn, moves);
+				int win = NEVER, loss = 0;
+				bool can_lose = true;
+				for (int i = 0; i < count; ++i) {
+					TBEntry entry{ TBResult::DRAW, 0 };
+					child(yellow, red, turn, moves[i].from, moves[i].to, entry);
+					if (entry.result == TBResult::WIN)
+						win = std::min(win, entry.distance + 1);
+					else if (entry.result == TBResult::LOSS)
+						loss = std::max(loss, entry.distance + 1);
+					else
+						can_lose = false;
+				}
+				win_wake[index] = (std::uint8_t) std::min<int>(win, NEVER);
+				if (can_lose && loss > 0)
+					loss_wake[index] = (std::uint8_t) std::min<int>(loss, NEVER - 1);
+				if (win != NEVER)
+					last_wake = std::max(last_wake, win);
+				if (loss_wake[index] != NEVER)
+					last_wake = std::max(last_wake, (int) loss_wake[index]);
+			}
+
+			std::uint64_t wins = 0, losses = 0;
+			int max_distance = 0;
+			for (int d = 1;; ++d) {
+				std::uint64_t settled = 0;
+				for (std::uint64_t index = 0; index < size; ++index) {
+					if (m_current[index] != 0)
+						continue;
+					if (!marked[index] && win_wake[index] != d && loss_wake[index] != d)
+						continue;
+					const std::uint16_t value = solve(index, d);
+					if (value == 0)
+						continue;
+					m_current[index] = value;
+					++settled;
+					markPredecessors(index, next_marked);
+				}
+				if (settled)
+					max_distance = d;
+				std::swap(marked, next_marked);
+				std::fill(next_marked.begin(), next_marked.end(), 0);
+				if (settled == 0 && d >= last_wake)
+					break;
+			}
+
+			std::vector<std::uint8_t>& table = m_tables[classIndex(yellow_count, red_count, m_max_pieces)];
+			table.resize(size);
+			for (std::uint64_t index = 0; index < size; ++index) {
+				const std::uint16_t value = m_current[index];
+				TBEntry entry{ TBResult::DRAW, 0 };
+				if (value & CURRENT_LOSS) {
+					entry = TBEntry{ TBResult::LOSS, value & ~CURRENT_LOSS };
+					++losses;
+				} else if (value) {
+					entry = TBEntry{ TBResult::WIN, value };
+					++wins;
+				}
+				table[index] = encode(entry);
+			}
+
+			const double seconds = std::chrono::duration<double>(
+				std::chrono::steady_clock::now() - start).count();
+			m_log << yellow_count << " yellow x " << red_count << " red: "
+			      << size << " positions, " << wins << " wins, " << losses
+			      << " losses, " << size - wins - losses << " draws, longest "
+			      << max_distance << " plies";
+			if (max_distance > Tablebase::MAX_DISTANCE)
+				m_log << " (saturated at " << Tablebase::MAX_DISTANCE << ")";
+			m_log << ", " << seconds << " s" << std::endl;
+		}
+
+		int legalMoves(BitMask yellow, BitMask red, Cell turn, Move* moves)
+		{
+			m_bits.setPieces(yellow, red);
+			int count = 0;
+			m_bits.forEachMove(turn, [&](int from, int to) {
+				moves[count++] = Move{ (std::uint8_t) from, (std::uint8_t) to };
+			});
+			return count;
+		}
+
+		int captureMoves(BitMask yellow, BitMask red, Cell turn, Move* moves)
+		{
+			const int count = legalMoves(yellow, red, turn, moves);
+			const BitMask targets = m_bits.captureTargets(turn);
+			int captures = 0;
+			for (int i = 0; i < count; ++i)
+				if (targets.test(moves[i].to))
+					moves[captures++] = moves[i];
+			return captures;
+		}
+
+		// Win or loss in exactly d plies, or 0
+		std::uint16_t solve(std::uint64_t index, int d)
+		{
+			BitMask yellow, red;
+			Cell turn;
+			unrank(m_cells, m_yellow, m_red, index, yellow, red, turn);
+			Move moves[Game::MAX_MOVES];
+			const int count = legalMoves(yellow, red, turn, moves);
+			if (count == 0)
+				return 0; // Neither side can move: a draw
+			bool all_lost = true;
+			for (int i = 0; i < count; ++i) {
+				TBEntry entry;
+				if (!child(yellow, red, turn, moves[i].from, moves[i].to, entry) ||
+					entry.distance > d - 1) {
+					all_lost = false;
+					continue;
+				}
+				if (entry.result == TBResult::WIN)
+					return (std::uint16_t) d;
+				if (entry.result == TBResult::DRAW)
+					all_lost = false;
+			}
+			return all_lost ? (std::uint16_t) (CURRENT_LOSS | d) : 0;
+		}
+
+		// Marks the positions of the current class that reach this one by a
+		// move that captures nothing
+		void markPredecessors(std::uint64_t index, std::vector<std::uint8_t>& marks)
+		{
+			BitMask yellow, red;
+			Cell turn;
+			unrank(m_cells, m_yellow, m_red, index, yellow, red, turn);
+			m_bits.setPieces(yellow, red);
+			const Cell other = turn == Cell::YELLOW ? Cell::RED : Cell::YELLOW;
+			// The enemy moved, or the player to move did it again because
+			// the enemy had no move left
+			const Cell movers[2] = { other, turn };
+			const int mover_count = m_bits.hasMove(other) ? 1 : 2;
+			const BitMask empty = m_bits.empty();
+			for (int k = 0; k < mover_count; ++k) {
+				const Cell mover = movers[k];
+				BitMask pieces = m_bits.pieces(mover);
+				while (pieces.any()) {
+					const int to = pieces.pop();
+					if (m_bits.captures(to, mover).any())
+						continue;
+					const BitMask piece = BitMask::bit(to);
+					const BitMask origins = empty & (m_bits.north(piece) |
+						m_bits.south(piece) | m_bits.west(piece) | m_bits.east(piece));
+					for (BitMask o = origins; o.any();) {
+						const BitMask moved = piece | BitMask::bit(o.pop());
+						const BitMask y = mover == Cell::YELLOW ? yellow ^ moved : yellow;
+						const BitMask r = mover == Cell::RED ? red ^ moved : red;
+						marks[rank(m_cells, y, r, mover)] = 1;
+					}
+				}
+			}
+		}
+	private:
+		BitBoard m_bits;
+		int m_cells;
+		int m_max_pieces;
+		int m_yellow, m_red; // class being built
+		std::vector<std::uint16_t> m_current; // distance, CURRENT_LOSS on losses
+		std::vector<std::vector<std::uint8_t>> m_tables;
+		std::ostream& m_log;
+	};
+}
+
+Tablebase::Tablebase() :
+	m_dim(0),
+	m_max_pieces(0)
+{
+}
+
+bool Tablebase::open(std::string const& path)
+{
+	m_offsets.clear();
+	m_dim = m_max_pieces = 0;
+	if (!m_file.open(path))
+		return false;
+	unsigned char const* data = m_file.getData();
+	const std::size_t size = m_file.getSize();
+	if (size < HEADER_SIZE || readLE(data, 4) != MAGIC || readLE(data + 4, 4) != VERSION) {
+		m_file.close();
+		return false;
+	}
+	const int dim = (int) readLE(data + 8, 4);
+	const int max_pieces = (int) readLE(data + 12, 4);
+	const int classes = classCount(max_pieces);
+	if (dim < 2 || dim > BitBoard::MAX_DIM || max_pieces < 2 ||
+		max_pieces > MAX_PIECES || max_pieces > dim * dim ||
+		size < HEADER_SIZE + classes * sizeof(std::uint64_t)) {
+		m_file.close();
+		return false;
+	}
+	for (int y = 1; y < max_pieces; ++y)
+		for (int r = 1; y + r <= max_pieces; ++r) {
+			const std::uint64_t offset = readLE(
+				data + HEADER_SIZE + m_offsets.size() * sizeof(std::uint64_t), 8);
+			if (offset > size || classSize(dim * dim, y, r) > size - offset) {
+				m_file.close();
+				m_offsets.clear();
+				return false; // Truncated file
+			}
+			m_offsets.push_back(offset);
+		}
+	m_dim = dim;
+	m_max_pieces = max_pieces;
+	return true;
+}
+
+bool Tablebase::isOpen() const
+{
+	return m_file.isOpen();
+}
+
+int Tablebase::getDimension() const
+{
+	return m_dim;
+}
+
+int Tablebase::getMaxPieces() const
+{
+	return m_max_pieces;
+}
+
+bool Tablebase::probe(Game const& game, TBEntry& entry) const
+{
+	BitBoard const& bits = game.getBits();
+	if (game.getStage() != Game::Stage::PLAYING || bits.getDimension() != m_dim)
+		return false;
+	return probe(bits.pieces(Cell::YELLOW), bits.pieces(Cell::RED),
+		game.getTurn(), entry);
+}
+
+bool Tablebase::probe(BitMask yellow, BitMask red, Cell turn, TBEntry& entry) const
+{
+	const int y = yellow.count(), r = red.count();
+	if (y == 0 || r == 0 || y + r > m_max_pieces)
+		return false;
+	const std::uint64_t offset = m_offsets[classIndex(y, r, m_max_pieces)];
+	const std::uint64_t index = rank(m_dim * m_dim, yellow, red, turn);
+	entry = decode(m_file.getData()[offset + index]);
+	return true;
+}
+
+bool Tablebase::chooseMove(Game& game, Move& move) const
+{
+	TBEntry entry;
+	if (!probe(game, entry))
+		return false;
+	// Saturated distances no longer tell which move makes progress
+	if (entry.distance >= MAX_DISTANCE)
+		return false;
+	Move moves[Game::MAX_MOVES];
+	const int count = game.getLegalMoves(moves);
+	if (count == 0)
+		return false;
+	const Cell me = game.getTurn();
+	int best = 0, best_preference = 0;
+	for (int i = 0; i < count; ++i) {
+		Game::Undo undo;
+		game.makeMove(moves[i], undo);
+		TBEntry child{ TBResult::WIN, 0 };
+		if (!game.isOver()) {
+			probe(game, child);
+			if (game.getTurn() != me)
+				child = flip(child);
+		}
+		game.unmakeMove(undo);
+		const int value = preference(child);
+		if (i == 0 || value > best_preference) {
+			best = i;
+			best_preference = value;
+		}
+	}
+	move = moves[best];
+	return true;
+}
+
+bool Tablebase::build(int dim, int max_pieces, std::string const& path,
+	std::ostream& log)
+{
+	if (dim < 2 || dim > BitBoard::MAX_DIM || max_pieces < 2 ||
+		max_pieces > MAX_PIECES || max_pieces > dim * dim)
+		return false;
+	Builder builder(dim, max_pieces, log);
+	builder.run();
+
+	std::ofstream out(path, std::ios::binary);
+	if (!out)
+		return false;
+	writeU32(out, MAGIC);
+	writeU32(out, VERSION);
+	writeU32(out, (std::uint32_t) dim);
+	writeU32(out, (std::uint32_t) max_pieces);
+	const int classes = classCount(max_pieces);
+	std::uint64_t offset = HEADER_SIZE + classes * sizeof(std::uint64_t);
+	for (int c = 0; c < classes; ++c) {
+		writeU64(out, offset);
+		offset += builder.getTable(c).size();
+	}
+	for (int c = 0; c < classes; ++c) {
+		std::vector<std::uint8_t> const& table = builder.getTable(c);
+		out.write((char const*) table.data(), (std::streamsize) table.size());
+	}
+	return (bool) out;
+}
@@ -0,0 +1,218 @@
+#include "tournament.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <random>
+
+#include "board.h"
+#include "selfplay.h"
+#include "workstealing.h"
+
+namespace
+{
+	constexpr double Z95 = 1.959964; // two-sided 95% normal quantile
+	constexpr unsigned long long SPRT_BATCH = 16; // pairs per thread
+
+	// Padded so that workers never share a cache line
+	struct alignas(64) Worker
+	{
+		std::default_random_engine rng;
+		std::vector<std::shared_ptr<Agent>> agents; // as in the options
+		SelfPlayStats stats;
+	};
+
+	// The k-th pair of games of agent a against agent b, from a's side:
+	// a plays yellow, then red, from the same seed
+	MatchScore playPair(SelfPlayOptions const& options, unsigned long long k,
+		Worker& worker, std::size_t a, std::size_t b)
+	{
+		MatchScore score;
+		for (int game = 0; game < 2; ++game) {
+			SelfPlayEngines engines;
+			engines.agents[0] = worker.agents[game == 0 ? a : b];
+			engines.agents[1] = worker.agents[game == 0 ? b : a];
+			const Cell winner = playSelfGame(options, k, worker.rng, engines,
+				worker.stats);
+			if (winner == Cell::EMPTY)
+				++score.draws;
+			else if (winner == (game == 0 ? Cell::YELLOW : Cell::RED))
+				++score.wins;
+			else
+				++score.losses;
+		}
+		++score.pairs[2 * score.wins + score.draws];
+		return score;
+	}
+}
+
+unsigned long long MatchScore::getGames() const
+{
+	return wins + draws + losses;
+}
+
+unsigned long long MatchScore::getPairs() const
+{
+	unsigned long long count = 0;
+	for (unsigned long long n : pairs)
+		count += n;
+	return count;
+}
+
+double MatchScore::getScore() const
+{
+	const unsigned long long games = getGames();
+	return games ? (wins + 0.5 * draws) / games : 0.5;
+}
+
+double MatchScore::getVariance() const
+{
+	const unsigned long long count = getPairs();
+	if (count == 0)
+		return 0.;
+	const double s = getScore();
+	double sum = 0.;
+	for (int h = 0; h < 5; ++h)
+		sum += pairs[h] * (h / 4. - s) * (h / 4. - s);
+	return sum / count;
+}
+
+double MatchScore::getElo() const
+{
+	return scoreToElo(getScore());
+}
+
+void MatchScore::getEloInterval(double& low, double& high) const
+{
+	const unsigned long long count = getPairs();
+	if (count == 0) {
+		low = -std::numeric_limits<double>::infinity();
+		high = std::numeric_limits<double>::infinity();
+		return;
+	}
+	const double margin = Z95 * std::sqrt(getVariance() / count);
+	low = scoreToElo(getScore() - margin);
+	high = scoreToElo(getScore() + margin);
+}
+
+MatchScore& MatchScore::operator+=(MatchScore const& other)
+{
+	wins += other.wins;
+	draws += other.draws;
+	losses += other.losses;
+	for (int h = 0; h < 5; ++h)
+		pairs[h] += other.pairs[h];
+	return *this;
+}
+
+MatchScore MatchScore::reversed() const
+{
+	MatchScore score;
+	score.wins = losses;
+	score.draws = draws;
+	score.losses = wins;
+	for (int h = 0; h < 5; ++h)
+		score.pairs[h] = pairs[4 - h];
+	return score;
+}
+
+double eloToScore(double elo)
+{
+	return 1. / (1. + std::pow(10., -elo / 400.));
+}
+
+double scoreToElo(double score)
+{
+	if (score <= 0.)
+		return -std::numeric_limits<double>::infinity();
+	if (score >= 1.)
+		return std::numeric_limits<double>::infinity();
+	return -400. * std::log10(1. / score - 1.);
+}
+
+double sprtLlr(MatchScore const& score, SprtOptions const& sprt)
+{
+	const double variance = score.getVariance();
+	if (variance <= 0.)
+		return 0.; // Nothing to tell the hypotheses apart yet
+	const double s0 = eloToScore(sprt.elo0), s1 = eloToScore(sprt.elo1);
+	return score.getPairs() * (s1 - s0) * (2. * score.getScore() - s0 - s1) /
+		(2. * variance);
+}
+
+SprtResult sprtTest(MatchScore const& score, SprtOptions const& sprt)
+{
+	const double llr = sprtLlr(score, sprt);
+	if (llr >= std::log((1. - sprt.beta) / sprt.alpha))
+		return SprtResult::H1;
+	if (llr <= std::log(sprt.beta / (1. - sprt.alpha)))
+		return SprtResult::H0;
+	return SprtResult::CONTINUE;
+}
+
+MatchScore TournamentResult::getTotal(std::size_t a) const
+{
+	MatchScore total;
+	for (std::size_t b = 0; b < scores[a].size(); ++b)
+		if (b != a)
+			total += scores[a][b];
+	return total;
+}
+
+TournamentResult runTournament(TournamentOptions const& options)
+{
+	const std::size_t count = options.agents.size();
+	assert(count >= 2);
+	std::vector<std::pair<std::size_t, std::size_t>> pairings;
+	for (std::size_t a = 0; a < count; ++a)
+		for (std::size_t b = a + 1; b < count; ++b)
+			pairings.emplace_back(a, b);
+
+	SelfPlayOptions games;
+	games.board_size = options.board_size;
+	games.seed = options.seed;
+	games.max_plies = options.max_plies;
+	games.agent = options.agent;
+	games.book = options.book;
+
+	WorkStealingRunner runner(options.threads);
+	std::unique_ptr<Worker[]> workers(new Worker[runner.getThreadCount()]);
+	for (unsigned int w = 0; w < runner.getThreadCount(); ++w)
+		for (std::string const& name : options.agents)
+			workers[w].agents.push_back(
+				AgentRegistry::instance().create(name, options.agent));
+
+	TournamentResult result;
+	result.agents = options.agents;
+	result.scores.assign(count, std::vector<MatchScore>(count));
+
+	// Under SPRT the pairs go in batches, each added pair by pair in order
+	// once all played, so only the last batch can be played in vain
+	const bool sprt = options.sprt.enabled && count == 2;
+	const unsigned long long batch = sprt
+		? SPRT_BATCH * runner.getThreadCount() : options.pairs;
+	std::vector<MatchScore> played;
+	for (unsigned long long first = 0; first < options.pairs; first += batch) {
+		const unsigned long long pairs = std::min(batch, options.pairs - first);
+		played.assign(pairs * pairings.size(), MatchScore());
+		runner.run(played.size(), [&](unsigned int w, unsigned long long n) {
+			const auto [a, b] = pairings[n % pairings.size()];
+			played[n] = playPair(games, first + n / pairings.size(), workers[w], a, b);
+		});
+		for (std::size_t n = 0; n < played.size(); ++n) {
+			const auto [a, b] = pairings[n % pairings.size()];
+			result.scores[a][b] += played[n];
+			result.scores[b][a] += played[n].reversed();
+			if ((n + 1) % pairings.size() == 0)
+				++result.pairs;
+			if (sprt) {
+				result.llr = sprtLlr(result.scores[0][1], options.sprt);
+				result.sprt = sprtTest(result.scores[0][1], options.sprt);
+				if (result.sprt != SprtResult::CONTINUE)
+					return result;
+			}
+		}
+	}
+	return result;
+}
@@ -0,0 +1,273 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+char const* trace::getName(Point point)
+{
+	static char const* const NAMES[] = {
+		"placePiecePrivate",
+		"movePiecePrivate",
+		"processMove",
+		"hasPossibleMove",
+		"chooseAiMove placing",
+		"chooseAiMove playing",
+	};
+	return point < Point::COUNT ? NAMES[(int) point] : "?";
+}
+
+#if defined(SEEGA_TRACE)
+
+namespace
+{
+	constexpr int POINT_COUNT = (int) trace::Point::COUNT;
+	// Bucket k holds the durations in [2^k, 2^(k+1)) ns, the first one
+	// also 0 and the last one everything longer
+	constexpr int BUCKET_COUNT = 40;
+
+	struct Event
+	{
+		std::uint64_t start;
+		std::uint64_t duration;
+		trace::Point point;
+	};
+
+	// Written by its thread only. The counters are atomic so that they can
+	// be read while it runs, but are updated with plain loads and stores.
+	struct alignas(64) Buffer
+	{
+		Event ring[trace::RING_SIZE];
+		std::atomic<std::uint64_t> written{ 0 };
+		std::atomic<std::uint64_t> buckets[POINT_COUNT][BUCKET_COUNT] = {};
+		std::atomic<std::uint64_t> total[POINT_COUNT] = {};
+		std::atomic<std::uint64_t> longest[POINT_COUNT] = {};
+	};
+
+	void bump(std::atomic<std::uint64_t>& counter, std::uint64_t amount)
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + amount,
+			std::memory_order_relaxed);
+	}
+
+	int getBucket(std::uint64_t duration)
+	{
+		int k = 0;
+		while (duration >>= 1)
+			++k;
+		return std::min(k, BUCKET_COUNT - 1);
+	}
+
+	// Buffers of every thread that recorded, kept after the threads end
+	// so that their calls are in the files written at exit. The buffer of
+	// an ended thread goes to the next thread that starts recording, so
+	// that threads started over and over (the helpers of each search) do
+	// not add a buffer each: there are as many as threads ever recorded at
+	// the same time, and a track of the trace may hold several threads
+	// one after the other.
+	class Registry
+	{
+	public:
+		static Registry& instance()
+		{
+			// Never destroyed, as the exit handler uses it
+			static Registry* registry = new Registry();
+			return *registry;
+		}
+
+		Buffer& acquire()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_free.empty()) {
+				Buffer* buffer = m_free.back();
+				m_free.pop_back();
+				return *buffer;
+			}
+			m_buffers.push_back(std::make_unique<Buffer>());
+			return *m_buffers.back();
+		}
+
+		void release(Buffer& buffer)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_free.push_back(&buffer);
+		}
+
+		template<class F>
+		void forEach(F f)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (std::size_t t = 0; t < m_buffers.size(); ++t)
+				f(t, *m_buffers[t]);
+		}
+
+		std::chrono::steady_clock::time_point getEpoch() const
+		{
+			return m_epoch;
+		}
+	private:
+		Registry() :
+			m_epoch(std::chrono::steady_clock::now())
+		{
+			std::atexit(writeAtExit);
+		}
+
+		static void writeAtExit()
+		{
+			char const* path = std::getenv("SEEGA_TRACE_FILE");
+			const std::string file = path && *path ? path : "seega_trace.json";
+			std::ofstream out(file);
+			trace::writeChromeTrace(out);
+			out.close();
+			if (!out)
+				std::cerr << "Could not write the trace '" << file << "'\n";
+			trace::writeSummary(std::cerr);
+		}
+	private:
+		std::chrono::steady_clock::time_point m_epoch;
+		std::mutex m_mutex;
+		std::vector<std::unique_ptr<Buffer>> m_buffers;
+		std::vector<Buffer*> m_free;
+	};
+
+	// Gives the buffer back when its thread ends
+	class Owner
+	{
+	public:
+		Owner() :
+			m_buffer(Registry::instance().acquire())
+		{
+		}
+		~Owner() { Registry::instance().release(m_buffer); }
+
+		Owner(Owner const&) = delete;
+		Owner& operator=(Owner const&) = delete;
+
+		Buffer& getBuffer() { return m_buffer; }
+	private:
+		Buffer& m_buffer;
+	};
+
+	Buffer& getBuffer()
+	{
+		thread_local Owner owner;
+		return owner.getBuffer();
+	}
+}
+
+std::uint64_t trace::now()
+{
+	static const auto epoch = Registry::instance().getEpoch();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - epoch).count();
+}
+
+void trace::record(Point point, std::uint64_t start, std::uint64_t end)
+{
+	Buffer& buffer = getBuffer();
+	const std::uint64_t duration = end - start;
+	const std::uint64_t written = buffer.written.load(std::memory_order_relaxed);
+	buffer.ring[written % RING_SIZE] = Event{ start, duration, point };
+	buffer.written.store(written + 1, std::memory_order_release);
+	const int p = (int) point;
+	bump(buffer.buckets[p][getBucket(duration)], 1);
+	bump(buffer.total[p], duration);
+	if (duration > buffer.longest[p].load(std::memory_order_relaxed))
+		buffer.longest[p].store(duration, std::memory_order_relaxed);
+}
+
+void trace::writeChromeTrace(std::ostream& out)
+{
+	// Complete events ("X"), in microseconds, one track per thread
+	out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+	bool first = true;
+	Registry::instance().forEach([&](std::size_t t, Buffer const& buffer) {
+		out << (first ? "\n" : ",\n")
+		    << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t
+		    << ",\"args\":{\"name\":\"thread " << t << "\"}}";
+		first = false;
+		const std::uint64_t written = buffer.written.load(std::memory_order_acquire);
+		const std::uint64_t begin = written > RING_SIZE ? written - RING_SIZE : 0;
+		for (std::uint64_t k = begin; k < written; ++k) {
+			Event const& event = buffer.ring[k % RING_SIZE];
+			out << ",\n{\"name\":\"" << getName(event.point)
+			    << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << t
+			    << ",\"ts\":" << event.start / 1000 << '.'
+			    << std::setw(3) << std::setfill('0') << event.start % 1000
+			    << ",\"dur\":" << event.duration / 1000 << '.'
+			    << std::setw(3) << event.duration % 1000
+			    << std::setfill(' ') << '}';
+		}
+	});
+	out << "\n]}\n";
+}
+
+void trace::writeSummary(std::ostream& out)
+{
+	std::uint64_t buckets[POINT_COUNT][BUCKET_COUNT] = {};
+	std::uint64_t total[POINT_COUNT] = {};
+	std::uint64_t longest[POINT_COUNT] = {};
+	Registry::instance().forEach([&](std::size_t, Buffer const& buffer) {
+		for (int p = 0; p < POINT_COUNT; ++p) {
+			for (int k = 0; k < BUCKET_COUNT; ++k)
+				buckets[p][k] += buffer.buckets[p][k].load(std::memory_order_relaxed);
+			total[p] += buffer.total[p].load(std::memory_order_relaxed);
+			longest[p] = std::max(longest[p],
+				buffer.longest[p].load(std::memory_order_relaxed));
+		}
+	});
+
+	// Upper bound of the bucket holding the given fraction of the calls
+	auto quantile = [&](int p, std::uint64_t calls, double q) {
+		const double target = q * calls;
+		std::uint64_t seen = 0;
+		for (int k = 0; k < BUCKET_COUNT; ++k)
+			if ((seen += buckets[p][k]) >= target)
+				return std::uint64_t(2) << k;
+		return longest[p];
+	};
+
+	out << std::left << std::setw(22) << "point" << std::right
+	    << std::setw(12) << "calls" << std::setw(12) << "total ms"
+	    << std::setw(10) << "mean ns" << std::setw(12) << "p50 ns <"
+	    << std::setw(12) << "p99 ns <" << std::setw(12) << "max ns" << '\n';
+	for (int p = 0; p < POINT_COUNT; ++p) {
+		std::uint64_t calls = 0;
+		for (int k = 0; k < BUCKET_COUNT; ++k)
+			calls += buckets[p][k];
+		if (calls == 0)
+			continue;
+		out << std::left << std::setw(22) << getName((Point) p) << std::right
+		    << std::setw(12) << calls
+		    << std::setw(12) << std::fixed << std::setprecision(1) << total[p] / 1e6
+		    << std::setw(10) << std::setprecision(0) << (double) total[p] / calls
+		    << std::setw(12) << quantile(p, calls, 0.5)
+		    << std::setw(12) << quantile(p, calls, 0.99)
+		    << std::setw(12) << longest[p] << '\n';
+	}
+	out << std::defaultfloat << std::setprecision(6);
+
+	for (int p = 0; p < POINT_COUNT; ++p) {
+		const std::uint64_t most = *std::max_element(buckets[p], buckets[p] + BUCKET_COUNT);
+		if (most == 0)
+			continue;
+		out << '\n' << getName((Point) p) << '\n';
+		for (int k = 0; k < BUCKET_COUNT; ++k) {
+			if (buckets[p][k] == 0)
+				continue;
+			out << std::setw(14) << (k ? std::uint64_t(1) << k : 0) << " ns "
+			    << std::setw(12) << buckets[p][k] << ' '
+			    << std::string((std::size_t) (40 * buckets[p][k] / most), '#') << '\n';
+		}
+	}
+}
+
+#endif
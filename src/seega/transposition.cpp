@@ -0,0 +1,124 @@
+#include "transposition.h"
+
+#include <algorithm>
+
+// Entry layout, from the lowest bit:
+//   32 score | 8 depth | 2 bound | 7 from | 7 to | 1 has move |
+//    6 generation | 1 used
+namespace
+{
+	constexpr int DEPTH_SHIFT = 32;
+	constexpr int BOUND_SHIFT = 40;
+	constexpr int FROM_SHIFT = 42;
+	constexpr int TO_SHIFT = 49;
+	constexpr int MOVE_SHIFT = 56;
+	constexpr int GENERATION_SHIFT = 57;
+	constexpr std::uint64_t USED = std::uint64_t(1) << 63;
+	constexpr std::uint8_t GENERATION_MASK = 0x3F;
+}
+
+TranspositionTable::TranspositionTable(std::size_t megabytes) :
+	m_mask(0),
+	m_generation(0)
+{
+	// Largest power of two number of slots that fits
+	const std::size_t bytes = std::max<std::size_t>(megabytes, 1) << 20;
+	std::size_t size = 1;
+	while (size * 2 * sizeof(Slot) <= bytes)
+		size *= 2;
+	m_slots.reset(new Slot[size]);
+	m_mask = size - 1;
+	clear();
+}
+
+std::size_t TranspositionTable::getSize() const
+{
+	return m_mask + 1;
+}
+
+void TranspositionTable::clear()
+{
+	for (std::size_t i = 0; i <= m_mask; ++i) {
+		m_slots[i].check.store(0, std::memory_order_relaxed);
+		m_slots[i].data.store(0, std::memory_order_relaxed);
+	}
+	m_generation = 0;
+}
+
+void TranspositionTable::newSearch()
+{
+	m_generation = (m_generation + 1) & GENERATION_MASK;
+}
+
+TTProbe TranspositionTable::probe(std::uint64_t key, TTEntry& entry) const
+{
+	Slot const& slot = m_slots[key & m_mask];
+	const std::uint64_t data = slot.data.load(std::memory_order_relaxed);
+	const std::uint64_t check = slot.check.load(std::memory_order_relaxed);
+	if (data == 0)
+		return TTProbe::EMPTY;
+	if ((check ^ data) != key)
+		return TTProbe::COLLISION;
+	entry = unpack(data);
+	return TTProbe::HIT;
+}
+
+void TranspositionTable::store(std::uint64_t key, TTEntry const& entry)
+{
+	Slot& slot = m_slots[key & m_mask];
+	const std::uint64_t old = slot.data.load(std::memory_order_relaxed);
+	const bool same = (slot.check.load(std::memory_order_relaxed) ^ old) == key;
+	// Keep deeper results of the current search about other positions
+	if (old != 0 && !same && generation(old) == m_generation &&
+		depth(old) > entry.depth)
+		return;
+	const std::uint64_t data = pack(entry, m_generation);
+	slot.check.store(key ^ data, std::memory_order_relaxed);
+	slot.data.store(data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const
+{
+	const std::size_t sample = std::min<std::size_t>(1000, m_mask + 1);
+	int used = 0;
+	for (std::size_t i = 0; i < sample; ++i) {
+		const std::uint64_t data = m_slots[i].data.load(std::memory_order_relaxed);
+		if (data != 0 && generation(data) == m_generation)
+			++used;
+	}
+	return (int) (used * 1000 / sample);
+}
+
+std::uint64_t TranspositionTable::pack(TTEntry const& entry, std::uint8_t generation)
+{
+	return (std::uint64_t) (std::uint32_t) entry.score
+		| (std::uint64_t) (std::uint8_t) entry.depth << DEPTH_SHIFT
+		| (std::uint64_t) entry.bound << BOUND_SHIFT
+		| (std::uint64_t) (entry.move.from & 0x7F) << FROM_SHIFT
+		| (std::uint64_t) (entry.move.to & 0x7F) << TO_SHIFT
+		| (std::uint64_t) entry.has_move << MOVE_SHIFT
+		| (std::uint64_t) generation << GENERATION_SHIFT
+		| USED;
+}
+
+TTEntry TranspositionTable::unpack(std::uint64_t data)
+{
+	TTEntry entry;
+	entry.score = (int) (std::int32_t) (std::uint32_t) data;
+	entry.depth = depth(data);
+	entry.bound = (Bound) ((data >> BOUND_SHIFT) & 0x3);
+	entry.move.from = (std::uint8_t) ((data >> FROM_SHIFT) & 0x7F);
+	entry.move.to = (std::uint8_t) ((data >> TO_SHIFT) & 0x7F);
+	entry.has_move = ((data >> MOVE_SHIFT) & 1) != 0;
+	return entry;
+}
+
+std::uint8_t TranspositionTable::generation(std::uint64_t data)
+{
+	return (std::uint8_t) ((data >> GENERATION_SHIFT) & GENERATION_MASK);
+}
+
+int TranspositionTable::depth(std::uint64_t data)
+{
+	return (int) (std::uint8_t) (data >> DEPTH_SHIFT);
+}
@@ -0,0 +1,72 @@
+#include "zobrist.h"
+
+#include "bitboard.h"
+#include "board.h"
+
+namespace
+{
+	constexpr int CELLS = BitBoard::MAX_DIM * BitBoard::MAX_DIM;
+
+	struct Keys
+	{
+		std::uint64_t cells[CELLS][2];
+		std::uint64_t red_turn;
+		std::uint64_t half_turn;
+
+		Keys()
+		{
+			// SplitMix64, fixed seed so hashes are stable across runs
+			std::uint64_t state = 0x5EE6A5EE6A5EE6A5ull;
+			auto next = [&state]() {
+				std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+				z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+				z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+				return z ^ (z >> 31);
+			};
+			for (int n = 0; n < CELLS; ++n) {
+				cells[n][0] = next();
+				cells[n][1] = next();
+			}
+			red_turn = next();
+			half_turn = next();
+		}
+	};
+
+	const Keys keys;
+}
+
+std::uint64_t zobrist::cell(int n, Cell cell)
+{
+	if (cell == Cell::EMPTY)
+		return 0;
+	return keys.cells[n][(int) cell - 1];
+}
+
+std::uint64_t zobrist::redTurn()
+{
+	return keys.red_turn;
+}
+
+std::uint64_t zobrist::halfTurn()
+{
+	return keys.half_turn;
+}
+
+std::uint64_t zobrist::hash(BitBoard const& bits, Cell turn, bool half_turn)
+{
+	return hash(bits.pieces(Cell::YELLOW), bits.pieces(Cell::RED), turn, half_turn);
+}
+
+std::uint64_t zobrist::hash(BitMask yellow, BitMask red, Cell turn, bool half_turn)
+{
+	std::uint64_t h = 0;
+	while (yellow.any())
+		h ^= keys.cells[yellow.pop()][0];
+	while (red.any())
+		h ^= keys.cells[red.pop()][1];
+	if (turn == Cell::RED)
+		h ^= keys.red_turn;
+	if (half_turn)
+		h ^= keys.half_turn;
+	return h;
+}
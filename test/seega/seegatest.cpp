@@ -0,0 +1,87 @@
+#include <cstdint>
+#include <iostream>
+
+#include <random>
+
+#include "bitboard.h"
+#include "board.h"
+#include "game.h"
+#include "symmetry.h"
+#include "tournament.h"
+
+namespace
+{
+	int failures = 0;
+
+	void check(bool condition, char const* what)
+	{
+		if (!condition) {
+			std::cerr << "FAILED: " << what << '\n';
+			++failures;
+		}
+	}
+
+	// Hash of the position with yellow pieces on the given cells
+	std::uint64_t hashOf(int dim, int const* cells, int count)
+	{
+		BitBoard bits(dim);
+		for (int k = 0; k < count; ++k)
+			bits.set(cells[k], Cell::YELLOW);
+		int transform;
+		return symmetry::canonicalHash(bits, Cell::RED, false, transform);
+	}
+
+	// Yellow on (0, 1) and (2, dim - 2) against its column mirror
+	bool mirrorHashesEqual(int dim)
+	{
+		const int cells[] = { 1, 2 * dim + dim - 2 };
+		int mirrored[2];
+		for (int k = 0; k < 2; ++k)
+			mirrored[k] = symmetry::mapCell(cells[k], 1, dim);
+		return hashOf(dim, cells, 2) == hashOf(dim, mirrored, 2);
+	}
+
+	// Self-play to the end: the loser is left with no piece on the board
+	bool playsToTheEnd(int dim)
+	{
+		std::default_random_engine rng(1);
+		Game game(dim, true, rng);
+		game.setVerbose(false);
+		while (!game.isOver() && game.getPlyCount() < 100000)
+			if (!game.autoPlay())
+				return false;
+		if (!game.isOver())
+			return false;
+		int winner = 0, loser = 0;
+		Board const& board = *game.getBoard();
+		for (int i = 0; i < dim; ++i)
+			for (int j = 0; j < dim; ++j) {
+				winner += board[i][j] == game.getWinner();
+				loser += board[i][j] != Cell::EMPTY && board[i][j] != game.getWinner();
+			}
+		return winner > 0 && loser == 0;
+	}
+}
+
+int main()
+{
+	// Every pair split one to one: the pairs agree, whatever the games did
+	MatchScore split;
+	split.wins = split.losses = 10;
+	split.pairs[2] = 10;
+	check(split.getVariance() == 0., "pairs that all score the same have no variance");
+	check(split.reversed().pairs[2] == 10, "a split pair stays split when reversed");
+
+	check(mirrorHashesEqual(5), "mirrored positions share a hash on odd boards");
+	check(mirrorHashesEqual(7), "mirrored positions share a hash on odd boards");
+	// The center cell moves under the mirror, so the positions differ
+	check(!mirrorHashesEqual(6), "mirrored positions hash apart on even boards");
+	check(!mirrorHashesEqual(4), "mirrored positions hash apart on even boards");
+	// Above BitBoard::MAX_DIM, by the rules over the board alone
+	check(playsToTheEnd(9), "a 9x9 game plays to the end");
+	check(playsToTheEnd(13), "a 13x13 game plays to the end");
+	check(playsToTheEnd(16), "a 16x16 game plays to the end");
+	if (failures == 0)
+		std::cout << "all passed\n";
+	return failures == 0 ? 0 : 1;
+}
@@ -3,17 +3,30 @@
 #include <string>
 #include <time.h>
 #include <cerrno>
+#include <functional>
+#include <algorithm>
+#include <limits>
 
 #include <GL/glut.h>
+#if defined(FREEGLUT)
+#include <GL/freeglut_ext.h>
+#endif
 
 #include "argparser.h"
 
 #include "game.h"
 #include "board.h"
+#include "agent.h"
+#include "tablebase.h"
+#include "openingbook.h"
+#include "gamerecord.h"
+#include "replay.h"
 
 #include "graphicscontroller.h"
 #include "gboard.h"
 #include "mousecontroller.h"
+#include "redrawscheduler.h"
+#include "gscrubber.h"
 
 #define WINDOW_WIDTH 640
 #define WINDOW_HEIGHT 640
@@ -23,6 +36,10 @@
 
 std::unique_ptr<GraphicsController> gcontroller_ptr = nullptr;
 std::unique_ptr<MouseController> mcontroller_ptr = nullptr;
+std::shared_ptr<RedrawScheduler> scheduler_ptr = nullptr;
+std::shared_ptr<GBoard> gboard_ptr = nullptr;
+std::shared_ptr<GScrubber> gscrubber_ptr = nullptr;
+std::function<std::shared_ptr<Game>()> new_game = nullptr;
 
 namespace arg = argparser;
 
@@ -43,13 +60,35 @@ std::string get_file_contents(std::string const& filename)
 
 void display()
 {
+	if (scheduler_ptr)
+		scheduler_ptr->beginFrame();
 	glClearColor(0.f, 0.f, 0.f, 0.f);
 	glClear(GL_COLOR_BUFFER_BIT);
 	if (gcontroller_ptr)
 		gcontroller_ptr->plot();
+	if (scheduler_ptr)
+		scheduler_ptr->endFrame();
 	glutSwapBuffers();
 }
 
+void reshape(int width, int height)
+{
+	glViewport(0, 0, width, height);
+	if (scheduler_ptr)
+		scheduler_ptr->resize(width, height);
+}
+
+// At most one frame per period, and none if nothing changed
+void tick(int)
+{
+	if (gcontroller_ptr)
+		gcontroller_ptr->update();
+	if (scheduler_ptr) {
+		scheduler_ptr->tick();
+		glutTimerFunc(scheduler_ptr->getFramePeriod(), tick, 0);
+	}
+}
+
 void click(int button, int state, int x, int y)
 {
 	if (mcontroller_ptr)
@@ -68,12 +107,68 @@ void move(int x, int y)
 		mcontroller_ptr->move_cb(x, y);
 }
 
+void keyboard(unsigned char key, int, int)
+{
+	// New game with the same options, the AI of the old one cancelled
+	if ((key == 'n' || key == 'N') && gboard_ptr && new_game)
+		gboard_ptr->setGame(new_game());
+}
+
+// Scrubbing through a recorded game
+void special(int key, int, int)
+{
+	if (!gscrubber_ptr)
+		return;
+	switch (key) {
+	case GLUT_KEY_LEFT:
+		gscrubber_ptr->seek(gscrubber_ptr->getPly() - 1);
+		break;
+	case GLUT_KEY_RIGHT:
+		gscrubber_ptr->seek(gscrubber_ptr->getPly() + 1);
+		break;
+	case GLUT_KEY_PAGE_UP:
+		gscrubber_ptr->seek(gscrubber_ptr->getPly() - gscrubber_ptr->getStep());
+		break;
+	case GLUT_KEY_PAGE_DOWN:
+		gscrubber_ptr->seek(gscrubber_ptr->getPly() + gscrubber_ptr->getStep());
+		break;
+	case GLUT_KEY_HOME:
+		gscrubber_ptr->seek(0);
+		break;
+	case GLUT_KEY_END:
+		gscrubber_ptr->seek(std::numeric_limits<int>::max());
+		break;
+	}
+}
+
+void close_window()
+{
+	// Stops the AI thread while everything it uses is still around
+	new_game = nullptr;
+	gscrubber_ptr = nullptr;
+	gboard_ptr = nullptr;
+	mcontroller_ptr = nullptr;
+	gcontroller_ptr = nullptr;
+}
+
 struct options_t
 {
 	int board_size;
 	bool ai_adversary;
 	bool ai_animate;
 	unsigned long ai_animation_duration;
+	std::string ai_type;
+	unsigned long ai_time;
+	int ai_depth;
+	unsigned long ai_hash;
+	unsigned long long ai_playouts;
+	unsigned int ai_threads;
+	bool ai_ponder;
+	std::string tablebase;
+	std::string book;
+	unsigned int frame_rate;
+	std::string record;
+	unsigned long long record_game;
 };
 
 int main(int argc, char** argv)
@@ -88,7 +183,8 @@ int main(int argc, char** argv)
 	arg::build_parser(argc, argv, options, regras_str.c_str())
 
 		.bind("tamanho", &options_t::board_size,
-			arg::doc("Tamanho do tabuleiro"),
+			arg::doc("Tamanho do tabuleiro (acima de " + std::to_string(BitBoard::MAX_DIM) +
+				", so o robo aleatorio joga)"),
 			arg::def(5))
 		
 		.bind("ia", &options_t::ai_adversary,
@@ -103,8 +199,96 @@ int main(int argc, char** argv)
 			arg::doc("Velocidade da animacao em milisegundos"),
 			arg::def(500))
 
+		.bind("ia-tipo", &options_t::ai_type,
+			arg::doc("Estrategia do robo (" + AgentRegistry::instance().listNames() + ")"),
+			arg::def("aleatorio"))
+
+		.bind("ia-tempo", &options_t::ai_time,
+			arg::doc("Tempo maximo da busca por jogada em milisegundos"),
+			arg::def(1000))
+
+		.bind("ia-profundidade", &options_t::ai_depth,
+			arg::doc("Profundidade maxima da busca"),
+			arg::def(64))
+
+		.bind("ia-hash", &options_t::ai_hash,
+			arg::doc("Tamanho da tabela de transposicao em MB (0 = sem tabela)"),
+			arg::def(16))
+
+		.bind("ia-simulacoes", &options_t::ai_playouts,
+			arg::doc("Simulacoes do mcts por jogada (0 = limitado so pelo tempo)"),
+			arg::def(0))
+
+		.bind("ia-threads", &options_t::ai_threads,
+			arg::doc("Threads da busca do robo, alfabeta ou mcts (0 = uma por nucleo)"),
+			arg::def(0))
+
+		.bind("ia-ponderar", &options_t::ai_ponder,
+			arg::doc("Robo continua pensando na vez do jogador (0 = so na vez dele)"),
+			arg::def(true))
+
+		.bind("tabela-finais", &options_t::tablebase,
+			arg::doc("Arquivo gerado pelo seegatb com as tabelas de finais (vazio = sem tabelas)"),
+			arg::def(""))
+
+		.bind("livro", &options_t::book,
+			arg::doc("Arquivo gerado pelo seegabook com as aberturas (vazio = sem livro)"),
+			arg::def(""))
+
+		.bind("quadros", &options_t::frame_rate,
+			arg::doc("Limite de quadros por segundo, de preferencia a taxa da tela"),
+			arg::def(60))
+
+		.bind("partida", &options_t::record,
+			arg::doc("Arquivo gerado pelo seegasim com as partidas a rever (vazio = jogar)"),
+			arg::def(""))
+
+		.bind("partida-numero", &options_t::record_game,
+			arg::doc("Numero da partida a rever no arquivo"),
+			arg::def(0))
+
 		.build();
 
+	if (!AgentRegistry::instance().contains(options.ai_type)) {
+		std::cerr << "Unknown AI type '" << options.ai_type << "' (known: "
+		          << AgentRegistry::instance().listNames() << ")\n";
+		return 1;
+	}
+
+	std::shared_ptr<Tablebase> tablebase;
+	if (!options.tablebase.empty()) {
+		tablebase = std::make_shared<Tablebase>();
+		if (!tablebase->open(options.tablebase)) {
+			std::cerr << "Could not open the tables '" << options.tablebase << "'\n";
+			return 1;
+		}
+	}
+
+	std::shared_ptr<OpeningBook> book;
+	if (!options.book.empty()) {
+		book = std::make_shared<OpeningBook>();
+		if (!book->open(options.book)) {
+			std::cerr << "Could not open the book '" << options.book << "'\n";
+			return 1;
+		}
+	}
+
+	if (options.board_size < 2) {
+		std::cerr << "The board size must be at least 2\n";
+		return 1;
+	}
+
+	if (options.ai_time == 0 && options.ai_playouts == 0 &&
+		options.ai_type == "mcts") {
+		std::cerr << "The mcts needs --ia-tempo or --ia-simulacoes above 0\n";
+		return 1;
+	}
+
+	if (options.frame_rate == 0) {
+		std::cerr << "The frame rate must be positive\n";
+		return 1;
+	}
+
 	gcontroller_ptr = std::make_unique<GraphicsController>();
 	mcontroller_ptr = std::make_unique<MouseController>(
 		WINDOW_WIDTH,
@@ -117,17 +301,84 @@ int main(int argc, char** argv)
 
 	//mcontroller_ptr->setDebug(true);
 
+	scheduler_ptr = std::make_shared<RedrawScheduler>(
+		-WINDOW_MARGIN,
+		WINDOW_PROJ_WIDTH + WINDOW_MARGIN,
+		WINDOW_PROJ_HEIGHT + WINDOW_MARGIN,
+		-WINDOW_MARGIN,
+		WINDOW_WIDTH,
+		WINDOW_HEIGHT,
+		std::max(1u, 1000 / options.frame_rate));
+
+	std::shared_ptr<Replay> replay;
+	if (!options.record.empty()) {
+		RecordReader reader;
+		RecordView view;
+		if (!reader.open(options.record)) {
+			std::cerr << "Could not open the games '" << options.record << "'\n";
+			return 1;
+		}
+		if (!reader.getGame(options.record_game, view)) {
+			std::cerr << "No game " << options.record_game << " in '" <<
+				options.record << "'\n";
+			return 1;
+		}
+		replay = std::make_shared<Replay>();
+		if (!replay->load(view))
+			std::cerr << "Game " << options.record_game <<
+				" breaks the rules after ply " << replay->getPlyCount() << "\n";
+		replay->seek(0);
+	}
+
 	std::default_random_engine rng((unsigned int) time(NULL));
-	auto game_ptr = std::make_shared<Game>(
-		options.board_size,
-		options.ai_adversary,
-		rng);
-	auto gboard_ptr = std::make_shared<GBoard>(
-		game_ptr,
-		options.ai_animate,
-		options.ai_animation_duration);
-	gcontroller_ptr->addGraphics(gboard_ptr);
-	mcontroller_ptr->addListener(gboard_ptr);
+	new_game = [options, tablebase, book, rng]() mutable {
+		auto game_ptr = std::make_shared<Game>(
+			options.board_size,
+			options.ai_adversary,
+			rng);
+		AgentOptions agent_options;
+		agent_options.search.time_ms = options.ai_time;
+		agent_options.search.max_depth = options.ai_depth;
+		agent_options.search.hash_mb = options.ai_hash;
+		agent_options.search.threads = options.ai_threads;
+		agent_options.mcts.time_ms = options.ai_time;
+		agent_options.mcts.max_playouts = options.ai_playouts;
+		agent_options.mcts.threads = options.ai_threads;
+		agent_options.mcts.seed = (unsigned int) rng();
+		agent_options.tablebase = tablebase;
+		game_ptr->setAgent(AgentRegistry::instance().create(options.ai_type, agent_options));
+		game_ptr->setTablebase(tablebase);
+		game_ptr->setOpeningBook(book);
+		return game_ptr;
+	};
+	if (replay) {
+		gboard_ptr = std::make_shared<GBoard>(
+			std::make_shared<Game>(replay->getGame()),
+			scheduler_ptr,
+			options.ai_animate,
+			options.ai_animation_duration);
+		gboard_ptr->setInteractive(false);
+		gboard_ptr->setPonder(false);
+		new_game = nullptr;
+
+		gscrubber_ptr = std::make_shared<GScrubber>(replay, gboard_ptr,
+			scheduler_ptr);
+		gscrubber_ptr->setPosition(0.f, WINDOW_PROJ_HEIGHT + WINDOW_MARGIN / 2,
+			WINDOW_PROJ_WIDTH);
+		gcontroller_ptr->addGraphics(gboard_ptr);
+		gcontroller_ptr->addGraphics(gscrubber_ptr);
+		mcontroller_ptr->addListener(gboard_ptr);
+		mcontroller_ptr->addListener(gscrubber_ptr);
+	} else {
+		gboard_ptr = std::make_shared<GBoard>(
+			new_game(),
+			scheduler_ptr,
+			options.ai_animate,
+			options.ai_animation_duration);
+		gboard_ptr->setPonder(options.ai_ponder);
+		gcontroller_ptr->addGraphics(gboard_ptr);
+		mcontroller_ptr->addListener(gboard_ptr);
+	}
 
 	glutInit(&argc, argv);
 	glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE);
@@ -135,9 +386,16 @@ int main(int argc, char** argv)
 	glutInitWindowPosition(10, 10);
 	glutCreateWindow("Seega");
 	glutDisplayFunc(display);
+	glutReshapeFunc(reshape);
+	glutTimerFunc(scheduler_ptr->getFramePeriod(), tick, 0);
 	glutMouseFunc(click);
 	glutMotionFunc(drag);
 	glutPassiveMotionFunc(move);
+	glutKeyboardFunc(keyboard);
+	glutSpecialFunc(special);
+#if defined(FREEGLUT)
+	glutCloseFunc(close_window);
+#endif
 	gluOrtho2D(
 		- WINDOW_MARGIN,
 		(double) WINDOW_PROJ_WIDTH + WINDOW_MARGIN,
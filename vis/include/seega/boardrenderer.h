@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+
+enum class Cell;
+
+// Draws the grid and the pieces of a board in a handful of calls.
+// The grid lines and a unit disc are built once in vertex buffers, and
+// every piece of a frame is one instance of the disc, with its own
+// position, radius and color, drawn by a single instanced call.
+// Without instancing (OpenGL below 3.3 and no ARB_instanced_arrays, or
+// no freeglut to load the entry points) it falls back to immediate mode,
+// still with the disc outline computed only once.
+class BoardRenderer
+{
+public:
+	BoardRenderer();
+	~BoardRenderer();
+	BoardRenderer(BoardRenderer const&) = delete;
+	BoardRenderer& operator=(BoardRenderer const&) = delete;
+
+	// Needs a current OpenGL context, so it waits for the first frame
+	void init(int disc_points);
+	bool isInstanced() const { return m_instanced; }
+
+	// Square grid of dim x dim cells with its top-left corner at (x, y),
+	// rebuilt only when one of them changes
+	void setGrid(float x, float y, float l, int dim);
+	void drawGrid(float r, float g, float b);
+
+	// Pieces are queued and drawn in the same order by drawPieces()
+	// Returns false, queueing nothing, for an empty cell.
+	bool addPiece(float cx, float cy, float radius, Cell color);
+	void drawPieces();
+private:
+	// Per-instance attributes, interleaved
+	struct Instance
+	{
+		float x, y, radius;
+		float r, g, b;
+	};
+
+	bool initInstancing();
+	void drawPiecesImmediate();
+private:
+	bool m_initialized;
+	bool m_instanced;
+	int m_disc_points;
+	std::vector<float> m_disc;  // unit circle outline, x y pairs
+	std::vector<float> m_grid;  // line segments, x y pairs
+	std::vector<Instance> m_instances;
+
+	// OpenGL objects, only used when instanced
+	unsigned int m_program;
+	unsigned int m_disc_buffer;
+	unsigned int m_grid_buffer;
+	unsigned int m_instance_buffer;
+	int m_vertex_location;
+	int m_offset_location;
+	int m_color_location;
+
+	// what m_grid was built for
+	float m_grid_x, m_grid_y, m_grid_l;
+	int m_grid_dim;
+	bool m_grid_dirty; // not uploaded yet
+};
@@ -2,9 +2,14 @@
 
 #include <memory>
 #include <chrono>
+#include <cstdint>
+#include <vector>
 
 #include "mousecontroller.h"
 #include "igraphics.h"
+#include "aiworker.h"
+#include "boardrenderer.h"
+#include "redrawscheduler.h"
 
 class Game;
 enum class Cell;
@@ -12,9 +17,12 @@ enum class Cell;
 class GBoard : public IGraphics, public IMouseListener
 {
 public:
-	GBoard(std::shared_ptr<Game> game, bool ai_animate = false,
+	GBoard(std::shared_ptr<Game> game,
+		std::shared_ptr<RedrawScheduler> scheduler,
+		bool ai_animate = false,
 		unsigned long long ai_animation_duration = 0) :
 		m_game(game),
+		m_scheduler(scheduler),
 		m_point_size(5.f),
 		m_disc_points(32),
 		m_disc_fill(0.8f),
@@ -23,14 +31,25 @@ public:
 		m_is_holding_piece(false),
 		m_ai_animate(ai_animate),
 		m_ai_is_animating(false),
-		m_ai_animation_duration(ai_animation_duration)
+		m_ai_animation_duration(ai_animation_duration),
+		m_ai_progress(0.f),
+		m_ai_worker((unsigned int) std::chrono::steady_clock::now().time_since_epoch().count()),
+		m_ponder(false),
+		m_interactive(true),
+		m_is_pondering(false),
+		m_pondered_hash(0),
+		m_drawn_cursor()
 	{
 		std::fill(m_held_piece_indices, m_held_piece_indices + 2, 0);
 		std::fill(m_held_piece_pos_ini, m_held_piece_pos_ini + 2, 0.f);
 		std::fill(m_held_piece_pos_fin, m_held_piece_pos_fin + 2, 0.f);
 		std::fill(m_placing_piece_pos, m_placing_piece_pos + 2, 0.f);
+		std::fill(m_ai_piece_pos, m_ai_piece_pos + 2, 0.f);
 	}
 
+	// Switches to another game, dropping the AI move being thought
+	void setGame(std::shared_ptr<Game> game);
+
 	// Setters
 	void setPointSize(float point_size) { m_point_size = point_size; }
 	void setDiscPoints(int disc_points) { m_disc_points = disc_points; }
@@ -38,29 +57,48 @@ public:
 	void setBoardPosition(float x, float y) { m_x = x; m_y = y; }
 	void setBoardLength(float l) { m_l = l; }
 	void setBoardColor(float r, float g, float b) { m_r = r; m_g = g; m_b = b; }
+	void setPonder(bool ponder) { m_ponder = ponder; }
+	// Whether the mouse plays (false to only show a replay)
+	void setInteractive(bool interactive) { m_interactive = interactive; }
 
 	// IGraphics
 	void plot() override;
+	void update() override;
 
 	// IMouseListener
 	void drag_cb(float x, float y) override;
 	void move_cb(float x, float y) override;
 	void click_cb(int button, int state, float x, float y) override;
 private:
-	void plotCircle(float cx, float cy, float r);
 	void getCellCenter(int i, int j, float* c);
-	
-	// returns true if there is a piece in the cell
-	// and false otherwise
-	bool setPlayerColor(Cell color) const;
+
+	// Areas covered by a cell and by a piece centered at (cx, cy)
+	Rect cellRect(int i, int j);
+	Rect pieceRect(float cx, float cy);
+	void invalidateCell(int i, int j);
+	void invalidatePiece(float const* c);
+
+	// Compares the game with what was drawn and invalidates the difference
+	void invalidateChanges();
+	void updateAnimation();
+	void getAiPiecePosition(float* c);
+	void getHeldPiecePosition(float* c);
 private:
 	std::shared_ptr<Game> m_game;
+	std::shared_ptr<RedrawScheduler> m_scheduler;
 
 	// ai
 	bool m_ai_animate;
 	bool m_ai_is_animating;
 	unsigned long long m_ai_animation_duration; // em ms
 	std::chrono::steady_clock::time_point m_ai_animation_start;
+	float m_ai_progress;
+	float m_ai_piece_pos[2]; // where the animating piece was last drawn
+	AiWorker m_ai_worker;
+	bool m_ponder; // search on the human's turn too
+	bool m_interactive;
+	bool m_is_pondering;
+	std::uint64_t m_pondered_hash;
 
 	// mouse controller
 	bool m_is_holding_piece;
@@ -75,4 +113,9 @@ private:
 	float m_disc_fill;
 	float m_r, m_g, m_b;
 	float m_x, m_y, m_l;
+	BoardRenderer m_renderer;
+
+	// what the window shows, to find what changed
+	std::vector<Cell> m_drawn;
+	Cell m_drawn_cursor; // EMPTY when the placing cursor is hidden
 };
\ No newline at end of file
@@ -17,6 +17,11 @@ public:
 		for (auto const& graphics : m_graphics_vector)
 			graphics->plot();
 	}
+	void update() override
+	{
+		for (auto const& graphics : m_graphics_vector)
+			graphics->update();
+	}
 private:
 	std::vector<std::shared_ptr<IGraphics>> m_graphics_vector;
 };
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <memory>
+
+#include "igraphics.h"
+#include "imouselistener.h"
+#include "redrawscheduler.h"
+
+class GBoard;
+class Replay;
+
+// Slider to scrub through a recorded game: clicking on the bar or
+// dragging its knob shows the board at that ply. Seeking goes through
+// the snapshots of the replay, so it costs a handful of plies at most.
+class GScrubber : public IGraphics, public IMouseListener
+{
+public:
+	GScrubber(std::shared_ptr<Replay> replay, std::shared_ptr<GBoard> board,
+		std::shared_ptr<RedrawScheduler> scheduler);
+
+	// Bar from (x, y) to (x + l, y)
+	void setPosition(float x, float y, float l);
+	void setColor(float r, float g, float b) { m_r = r; m_g = g; m_b = b; }
+
+	// Also for the keyboard
+	void seek(int ply);
+	int getPly() const;
+	int getStep() const; // plies between snapshots
+
+	// IGraphics
+	void plot() override;
+
+	// IMouseListener
+	void drag_cb(float x, float y) override;
+	void move_cb(float x, float y) override;
+	void click_cb(int button, int state, float x, float y) override;
+private:
+	Rect getArea() const;
+	int getPlyAt(float x) const;
+private:
+	std::shared_ptr<Replay> m_replay;
+	std::shared_ptr<GBoard> m_board;
+	std::shared_ptr<RedrawScheduler> m_scheduler;
+	bool m_is_dragging;
+
+	// plotting parameters
+	float m_x, m_y, m_l;
+	float m_knob; // half the knob side
+	float m_r, m_g, m_b;
+};
@@ -5,4 +5,6 @@ class IGraphics
 public:
 	virtual ~IGraphics() {}
 	virtual void plot() = 0;
+	// Once per frame period, before any drawing: advance the state
+	virtual void update() {}
 };
\ No newline at end of file
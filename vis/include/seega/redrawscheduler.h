@@ -0,0 +1,66 @@
+#pragma once
+
+// Area of the world, in the coordinates of the projection
+struct Rect
+{
+	float x0, y0, x1, y1; // x0 <= x1 and y0 <= y1
+
+	bool intersects(Rect const& other) const
+	{
+		return x0 <= other.x1 && other.x0 <= x1 &&
+			y0 <= other.y1 && other.y0 <= y1;
+	}
+};
+
+// Decides when a frame is drawn and what part of the window it covers.
+// Graphics report what changed with invalidate(), and a timer running at
+// the frame rate calls tick(), which posts a redisplay only if something
+// did. When GLX_EXT_buffer_age says the back buffer holds the last frame,
+// the frame is then scissored to the changed area, and when it holds the
+// frame before last, to that area joined with the one of the previous
+// frame. Otherwise its contents are undefined and the frame is drawn
+// whole, as are frames the scheduler did not post (the window was
+// exposed, say).
+class RedrawScheduler
+{
+public:
+	// Projection bounds, as given to gluOrtho2D, and window size in pixels
+	RedrawScheduler(float left, float right, float bottom, float top,
+		int width, int height, unsigned int frame_ms);
+
+	unsigned int getFramePeriod() const { return m_frame_ms; }
+	void resize(int width, int height);
+
+	void invalidate(Rect const& rect);
+	void invalidateAll();
+	bool isDirty() const { return m_dirty || m_dirty_all; }
+
+	// Posts a redisplay if anything changed since the last frame
+	void tick();
+
+	// Around the drawing of a frame: set up and release the scissor
+	void beginFrame();
+	void endFrame();
+
+	// Whether the area is repainted by the frame being drawn
+	bool isRedrawn(Rect const& rect) const;
+private:
+	static void join(Rect& rect, Rect const& other);
+private:
+	float m_left, m_right, m_bottom, m_top;
+	int m_width, m_height;
+	unsigned int m_frame_ms;
+	bool m_posted;
+
+	// changed since the last frame
+	bool m_dirty, m_dirty_all;
+	Rect m_dirty_rect;
+
+	// changed by the last frame
+	bool m_last, m_last_all;
+	Rect m_last_rect;
+
+	// repainted by the current frame
+	bool m_frame_all;
+	Rect m_frame_rect;
+};
@@ -0,0 +1,346 @@
+#include "boardrenderer.h"
+
+#include <cstdio>
+#include <cstring>
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+#include <GL/glut.h>
+#if defined(FREEGLUT)
+#include <GL/freeglut_ext.h>
+#endif
+
+#include "board.h"
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+// Entry points past OpenGL 1.1, loaded at run time since the system
+// headers and libraries only promise 1.1 on every platform
+namespace
+{
+	constexpr GLenum ARRAY_BUFFER = 0x8892;
+	constexpr GLenum STATIC_DRAW = 0x88E4;
+	constexpr GLenum STREAM_DRAW = 0x88E0;
+	constexpr GLenum FRAGMENT_SHADER = 0x8B30;
+	constexpr GLenum VERTEX_SHADER = 0x8B31;
+	constexpr GLenum COMPILE_STATUS = 0x8B81;
+	constexpr GLenum LINK_STATUS = 0x8B82;
+
+	// Fixed attribute locations, bound before linking
+	constexpr GLuint VERTEX_ATTRIBUTE = 0;
+	constexpr GLuint OFFSET_ATTRIBUTE = 1;
+	constexpr GLuint COLOR_ATTRIBUTE = 2;
+
+	const char* const VERTEX_SHADER_SOURCE =
+		"#version 120\n"
+		"attribute vec2 a_vertex;\n" // unit disc
+		"attribute vec3 a_offset;\n" // center x, center y, radius
+		"attribute vec3 a_color;\n"
+		"varying vec3 v_color;\n"
+		"void main()\n"
+		"{\n"
+		"	v_color = a_color;\n"
+		"	vec2 position = a_offset.xy + a_vertex * a_offset.z;\n"
+		"	gl_Position = gl_ModelViewProjectionMatrix * vec4(position, 0.0, 1.0);\n"
+		"}\n";
+
+	const char* const FRAGMENT_SHADER_SOURCE =
+		"#version 120\n"
+		"varying vec3 v_color;\n"
+		"void main()\n"
+		"{\n"
+		"	gl_FragColor = vec4(v_color, 1.0);\n"
+		"}\n";
+
+	struct GLFunctions
+	{
+		void (APIENTRY* genBuffers)(GLsizei, GLuint*);
+		void (APIENTRY* deleteBuffers)(GLsizei, GLuint const*);
+		void (APIENTRY* bindBuffer)(GLenum, GLuint);
+		void (APIENTRY* bufferData)(GLenum, std::ptrdiff_t, void const*, GLenum);
+		GLuint (APIENTRY* createShader)(GLenum);
+		void (APIENTRY* deleteShader)(GLuint);
+		void (APIENTRY* shaderSource)(GLuint, GLsizei, char const* const*, GLint const*);
+		void (APIENTRY* compileShader)(GLuint);
+		void (APIENTRY* getShaderiv)(GLuint, GLenum, GLint*);
+		GLuint (APIENTRY* createProgram)();
+		void (APIENTRY* deleteProgram)(GLuint);
+		void (APIENTRY* attachShader)(GLuint, GLuint);
+		void (APIENTRY* bindAttribLocation)(GLuint, GLuint, char const*);
+		void (APIENTRY* linkProgram)(GLuint);
+		void (APIENTRY* getProgramiv)(GLuint, GLenum, GLint*);
+		void (APIENTRY* useProgram)(GLuint);
+		void (APIENTRY* vertexAttribPointer)(GLuint, GLint, GLenum, GLboolean, GLsizei, void const*);
+		void (APIENTRY* enableVertexAttribArray)(GLuint);
+		void (APIENTRY* disableVertexAttribArray)(GLuint);
+		void (APIENTRY* vertexAttribDivisor)(GLuint, GLuint);
+		void (APIENTRY* drawArraysInstanced)(GLenum, GLint, GLsizei, GLsizei);
+	};
+
+	GLFunctions gl;
+
+	template<class F>
+	bool load(F& f, char const* name)
+	{
+#if defined(FREEGLUT)
+		f = reinterpret_cast<F>(glutGetProcAddress(name));
+#else
+		f = nullptr;
+#endif
+		return f != nullptr;
+	}
+
+	bool hasExtension(char const* name)
+	{
+		char const* extensions = (char const*) glGetString(GL_EXTENSIONS);
+		return extensions && std::strstr(extensions, name) != nullptr;
+	}
+
+	bool loadFunctions()
+	{
+		char const* version = (char const*) glGetString(GL_VERSION);
+		int major = 0, minor = 0;
+		if (!version || std::sscanf(version, "%d.%d", &major, &minor) != 2 || major < 2)
+			return false; // No shaders
+		bool ok =
+			load(gl.genBuffers, "glGenBuffers") &&
+			load(gl.deleteBuffers, "glDeleteBuffers") &&
+			load(gl.bindBuffer, "glBindBuffer") &&
+			load(gl.bufferData, "glBufferData") &&
+			load(gl.createShader, "glCreateShader") &&
+			load(gl.deleteShader, "glDeleteShader") &&
+			load(gl.shaderSource, "glShaderSource") &&
+			load(gl.compileShader, "glCompileShader") &&
+			load(gl.getShaderiv, "glGetShaderiv") &&
+			load(gl.createProgram, "glCreateProgram") &&
+			load(gl.deleteProgram, "glDeleteProgram") &&
+			load(gl.attachShader, "glAttachShader") &&
+			load(gl.bindAttribLocation, "glBindAttribLocation") &&
+			load(gl.linkProgram, "glLinkProgram") &&
+			load(gl.getProgramiv, "glGetProgramiv") &&
+			load(gl.useProgram, "glUseProgram") &&
+			load(gl.vertexAttribPointer, "glVertexAttribPointer") &&
+			load(gl.enableVertexAttribArray, "glEnableVertexAttribArray") &&
+			load(gl.disableVertexAttribArray, "glDisableVertexAttribArray");
+		if (!ok)
+			return false;
+		if (major > 3 || (major == 3 && minor >= 3))
+			return load(gl.vertexAttribDivisor, "glVertexAttribDivisor") &&
+				load(gl.drawArraysInstanced, "glDrawArraysInstanced");
+		return hasExtension("GL_ARB_instanced_arrays") &&
+			hasExtension("GL_ARB_draw_instanced") &&
+			load(gl.vertexAttribDivisor, "glVertexAttribDivisorARB") &&
+			load(gl.drawArraysInstanced, "glDrawArraysInstancedARB");
+	}
+
+	GLuint compile(GLenum type, char const* source)
+	{
+		const GLuint shader = gl.createShader(type);
+		gl.shaderSource(shader, 1, &source, nullptr);
+		gl.compileShader(shader);
+		GLint status = 0;
+		gl.getShaderiv(shader, COMPILE_STATUS, &status);
+		if (!status) {
+			gl.deleteShader(shader);
+			return 0;
+		}
+		return shader;
+	}
+
+	void color(Cell cell, float* rgb)
+	{
+		rgb[0] = 1.f;
+		rgb[1] = cell == Cell::YELLOW ? 1.f : 0.f;
+		rgb[2] = 0.f;
+	}
+}
+
+BoardRenderer::BoardRenderer() :
+	m_initialized(false),
+	m_instanced(false),
+	m_disc_points(0),
+	m_program(0),
+	m_disc_buffer(0),
+	m_grid_buffer(0),
+	m_instance_buffer(0),
+	m_vertex_location(VERTEX_ATTRIBUTE),
+	m_offset_location(OFFSET_ATTRIBUTE),
+	m_color_location(COLOR_ATTRIBUTE),
+	m_grid_x(0), m_grid_y(0), m_grid_l(0), m_grid_dim(0),
+	m_grid_dirty(true)
+{
+}
+
+BoardRenderer::~BoardRenderer()
+{
+	if (!m_instanced)
+		return;
+	const GLuint buffers[3] = { m_disc_buffer, m_grid_buffer, m_instance_buffer };
+	gl.deleteBuffers(3, buffers);
+	gl.deleteProgram(m_program);
+}
+
+void BoardRenderer::init(int disc_points)
+{
+	if (m_initialized)
+		return;
+	m_initialized = true;
+	m_disc_points = disc_points;
+	m_disc.clear();
+	const double dt = 2 * M_PI / disc_points;
+	for (int n = 0; n < disc_points; ++n) {
+		m_disc.push_back((float) cos(n * dt));
+		m_disc.push_back((float) sin(n * dt));
+	}
+	m_instanced = initInstancing();
+}
+
+bool BoardRenderer::initInstancing()
+{
+	if (!loadFunctions())
+		return false;
+	const GLuint vertex = compile(VERTEX_SHADER, VERTEX_SHADER_SOURCE);
+	const GLuint fragment = compile(FRAGMENT_SHADER, FRAGMENT_SHADER_SOURCE);
+	if (!vertex || !fragment) {
+		if (vertex)
+			gl.deleteShader(vertex);
+		if (fragment)
+			gl.deleteShader(fragment);
+		return false;
+	}
+	m_program = gl.createProgram();
+	gl.attachShader(m_program, vertex);
+	gl.attachShader(m_program, fragment);
+	gl.bindAttribLocation(m_program, VERTEX_ATTRIBUTE, "a_vertex");
+	gl.bindAttribLocation(m_program, OFFSET_ATTRIBUTE, "a_offset");
+	gl.bindAttribLocation(m_program, COLOR_ATTRIBUTE, "a_color");
+	gl.linkProgram(m_program);
+	gl.deleteShader(vertex); // Kept alive by the program
+	gl.deleteShader(fragment);
+	GLint status = 0;
+	gl.getProgramiv(m_program, LINK_STATUS, &status);
+	if (!status) {
+		gl.deleteProgram(m_program);
+		m_program = 0;
+		return false;
+	}
+
+	GLuint buffers[3];
+	gl.genBuffers(3, buffers);
+	m_disc_buffer = buffers[0];
+	m_grid_buffer = buffers[1];
+	m_instance_buffer = buffers[2];
+	gl.bindBuffer(ARRAY_BUFFER, m_disc_buffer);
+	gl.bufferData(ARRAY_BUFFER, (std::ptrdiff_t) (m_disc.size() * sizeof(float)),
+		m_disc.data(), STATIC_DRAW);
+	gl.bindBuffer(ARRAY_BUFFER, 0);
+	return true;
+}
+
+void BoardRenderer::setGrid(float x, float y, float l, int dim)
+{
+	if (!m_grid.empty() && x == m_grid_x && y == m_grid_y && l == m_grid_l &&
+		dim == m_grid_dim)
+		return; // Already built
+	m_grid_x = x;
+	m_grid_y = y;
+	m_grid_l = l;
+	m_grid_dim = dim;
+	const float div = l / dim;
+	m_grid.clear();
+	for (int k = 0; k <= dim; ++k) {
+		const float at = k * div;
+		// Vertical line, then horizontal line
+		m_grid.insert(m_grid.end(), { x + at, y, x + at, y + l });
+		m_grid.insert(m_grid.end(), { x, y + at, x + l, y + at });
+	}
+	m_grid_dirty = true;
+}
+
+void BoardRenderer::drawGrid(float r, float g, float b)
+{
+	glColor3f(r, g, b);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	if (m_instanced) {
+		gl.bindBuffer(ARRAY_BUFFER, m_grid_buffer);
+		if (m_grid_dirty)
+			gl.bufferData(ARRAY_BUFFER, (std::ptrdiff_t) (m_grid.size() * sizeof(float)),
+				m_grid.data(), STATIC_DRAW);
+		glVertexPointer(2, GL_FLOAT, 0, nullptr);
+		glDrawArrays(GL_LINES, 0, (GLsizei) (m_grid.size() / 2));
+		gl.bindBuffer(ARRAY_BUFFER, 0);
+	} else {
+		glVertexPointer(2, GL_FLOAT, 0, m_grid.data());
+		glDrawArrays(GL_LINES, 0, (GLsizei) (m_grid.size() / 2));
+	}
+	glDisableClientState(GL_VERTEX_ARRAY);
+	m_grid_dirty = false;
+}
+
+bool BoardRenderer::addPiece(float cx, float cy, float radius, Cell cell)
+{
+	if (cell == Cell::EMPTY)
+		return false;
+	Instance instance{ cx, cy, radius, 0.f, 0.f, 0.f };
+	color(cell, &instance.r);
+	m_instances.push_back(instance);
+	return true;
+}
+
+void BoardRenderer::drawPieces()
+{
+	if (m_instances.empty())
+		return;
+	if (!m_instanced) {
+		drawPiecesImmediate();
+		m_instances.clear();
+		return;
+	}
+	gl.useProgram(m_program);
+
+	gl.bindBuffer(ARRAY_BUFFER, m_disc_buffer);
+	gl.enableVertexAttribArray(m_vertex_location);
+	gl.vertexAttribPointer(m_vertex_location, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+
+	// New storage every frame, so the driver never waits on the last one
+	gl.bindBuffer(ARRAY_BUFFER, m_instance_buffer);
+	gl.bufferData(ARRAY_BUFFER, (std::ptrdiff_t) (m_instances.size() * sizeof(Instance)),
+		m_instances.data(), STREAM_DRAW);
+	const GLsizei stride = (GLsizei) sizeof(Instance);
+	gl.enableVertexAttribArray(m_offset_location);
+	gl.vertexAttribPointer(m_offset_location, 3, GL_FLOAT, GL_FALSE, stride,
+		(void const*) offsetof(Instance, x));
+	gl.vertexAttribDivisor(m_offset_location, 1);
+	gl.enableVertexAttribArray(m_color_location);
+	gl.vertexAttribPointer(m_color_location, 3, GL_FLOAT, GL_FALSE, stride,
+		(void const*) offsetof(Instance, r));
+	gl.vertexAttribDivisor(m_color_location, 1);
+
+	gl.drawArraysInstanced(GL_TRIANGLE_FAN, 0, m_disc_points,
+		(GLsizei) m_instances.size());
+
+	// Leave the state as fixed function code expects it
+	gl.vertexAttribDivisor(m_offset_location, 0);
+	gl.vertexAttribDivisor(m_color_location, 0);
+	gl.disableVertexAttribArray(m_vertex_location);
+	gl.disableVertexAttribArray(m_offset_location);
+	gl.disableVertexAttribArray(m_color_location);
+	gl.bindBuffer(ARRAY_BUFFER, 0);
+	gl.useProgram(0);
+	m_instances.clear();
+}
+
+void BoardRenderer::drawPiecesImmediate()
+{
+	for (Instance const& instance : m_instances) {
+		glColor3f(instance.r, instance.g, instance.b);
+		glBegin(GL_POLYGON);
+		for (int n = 0; n < m_disc_points; ++n)
+			glVertex2f(instance.x + instance.radius * m_disc[2 * n],
+				instance.y + instance.radius * m_disc[2 * n + 1]);
+		glEnd();
+	}
+}
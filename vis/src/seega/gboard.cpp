@@ -3,9 +3,6 @@
 #include <thread>
 #include <chrono>
 
-#define _USE_MATH_DEFINES
-#include <math.h>
-
 #include <GL/glut.h>
 
 #include "game.h"
@@ -20,20 +17,10 @@ void GBoard::plot()
 	auto m_board = m_game->getBoard();
 	const int dim = m_board->getDimension();
 	const float div = m_l / dim;
-	glColor3f(m_r, m_g, m_b);
+	m_renderer.init(m_disc_points);
 	glPointSize(m_point_size);
-	for (int i = 0; i <= dim; ++i) {
-		glBegin(GL_LINE_STRIP);
-		for (int j = 0; j <= dim; ++j)
-			glVertex2f(m_x + i * div, m_y + j * div);
-		glEnd();
-	}
-	for (int i = 0; i <= dim; ++i) {
-		glBegin(GL_LINE_STRIP);
-		for (int j = 0; j <= dim; ++j)
-			glVertex2f(m_x + j * div, m_y + i * div);
-		glEnd();
-	}
+	m_renderer.setGrid(m_x, m_y, m_l, dim);
+	m_renderer.drawGrid(m_r, m_g, m_b); // clipped to what changed
 	/* Cells */
 	int const* last_move = m_game->getLastMove();
 	auto const& last_removed = m_game->getLastRemoved();
@@ -58,115 +45,193 @@ void GBoard::plot()
 				if (was_last_removed)
 					continue; // skip removed pieces
 			}
-			if (setPlayerColor((*m_board)[i][j])) {
-				float c[2];
-				getCellCenter(i, j, c);
-				plotCircle(c[0], c[1], r);
-			}
+			float c[2];
+			getCellCenter(i, j, c);
+			if (m_scheduler->isRedrawn(pieceRect(c[0], c[1])))
+				m_renderer.addPiece(c[0], c[1], r, (*m_board)[i][j]);
 		}
 	/* Special cells */
 	if (m_is_holding_piece) {
 		float c[2];
-		int i = m_held_piece_indices[0];
-		int j = m_held_piece_indices[1];
-		getCellCenter(i, j, c);
-		c[0] += m_held_piece_pos_fin[0] - m_held_piece_pos_ini[0];
-		c[1] += m_held_piece_pos_fin[1] - m_held_piece_pos_ini[1];
-		if (setPlayerColor((*m_board)[i][j]))
-			plotCircle(c[0], c[1], r);
-	}
-	if (m_game->getStage() == Game::Stage::PLACING_PIECES &&
-		!m_game->isAiTurn()) {
-		Cell piece_color = m_game->getTurn();
-		if (setPlayerColor(piece_color))
-			plotCircle(m_placing_piece_pos[0], m_placing_piece_pos[1], r);
+		getHeldPiecePosition(c);
+		m_renderer.addPiece(c[0], c[1], r,
+			(*m_board)[m_held_piece_indices[0]][m_held_piece_indices[1]]);
 	}
+	if (m_drawn_cursor != Cell::EMPTY)
+		m_renderer.addPiece(m_placing_piece_pos[0], m_placing_piece_pos[1], r,
+			m_drawn_cursor);
 	if (m_ai_is_animating) {
-		auto now = std::chrono::steady_clock::now();
-		unsigned long long dt =
-			std::chrono::duration_cast<std::chrono::milliseconds>
-			(now - m_ai_animation_start).count();
-		float progress;
-		if (dt >= m_ai_animation_duration) {
-			progress = 1.f;
-			m_ai_is_animating = false;
-		} else {
-			progress = (float) dt / (float) m_ai_animation_duration;
+		// The captured pieces stay until the end of the animation
+		for (auto const& [rem_i, rem_j] : last_removed) {
+			float c[2];
+			getCellCenter(rem_i, rem_j, c);
+			m_renderer.addPiece(c[0], c[1], r, m_game->getTurn());
 		}
-		Cell piece_color = m_game->getTurn();
-		if (progress != 1.f) {
-			setPlayerColor(piece_color);
-			for (auto const& [rem_i, rem_j] : last_removed) {
-				float c[2];
-				getCellCenter(rem_i, rem_j, c);
-				plotCircle(c[0], c[1], r);
+		m_renderer.addPiece(m_ai_piece_pos[0], m_ai_piece_pos[1], r,
+			m_game->getAiColor());
+	}
+	m_renderer.drawPieces();
+}
+
+void GBoard::update()
+{
+	invalidateChanges();
+	if (m_ai_is_animating)
+		updateAnimation();
+	if (!m_game->isAiTurn()) {
+		// Warms up the AI for its next turn, once per position
+		if (m_ponder && !m_game->isOver()) {
+			if (!m_is_pondering || m_game->getHash() != m_pondered_hash) {
+				m_ai_worker.ponder(*m_game);
+				m_is_pondering = true;
+				m_pondered_hash = m_game->getHash();
 			}
+		} else if (m_is_pondering) {
+			m_ai_worker.cancel();
+			m_is_pondering = false;
 		}
-		float last_positions[4];
-		getCellCenter(last_move[0], last_move[1], last_positions);
-		getCellCenter(last_move[2], last_move[3], last_positions + 2);
-		float curr_x = last_positions[0] * (1.f - progress) + last_positions[2] * progress;
-		float curr_y = last_positions[1] * (1.f - progress) + last_positions[3] * progress;
-		setPlayerColor(m_game->getAiColor());
-		plotCircle(curr_x, curr_y, r);
-		if (progress < 1.f)
-			glutPostRedisplay();
+		return;
 	}
-	if (m_game->isAiTurn()) {
-		m_game->letAiPlay();
+	m_is_pondering = false; // start() below cancels it
+	// The AI thinks on its own thread, and its move is played here once
+	// the last move is on the screen and done animating
+	if (!m_ai_worker.isBusy())
+		m_ai_worker.start(*m_game);
+	Move move;
+	if (!m_ai_is_animating && !m_scheduler->isDirty() &&
+		m_ai_worker.poll(move) && m_game->playAiMove(move)) {
 		if (m_ai_animate && m_game->getStage() == Game::Stage::PLAYING) {
 			m_ai_is_animating = true;
 			m_ai_animation_start = std::chrono::steady_clock::now();
+			m_ai_progress = 0.f;
+			getAiPiecePosition(m_ai_piece_pos);
 		}
-		glutPostRedisplay();
+		invalidateChanges();
 	}
 }
 
-void GBoard::plotCircle(float cx, float cy, float r)
+void GBoard::setGame(std::shared_ptr<Game> game)
 {
-	/* Parametric plot */
-	double t = 0;
-	const double dt = 2 * M_PI / m_disc_points;
-	glBegin(GL_POLYGON);
-	for (int n = 0; n < m_disc_points; ++n, t += dt) {
-		double x = r * cos(t) + cx;
-		double y = r * sin(t) + cy;
-		glVertex2d(x, y);
+	m_ai_worker.cancel();
+	m_is_pondering = false;
+	m_game = game;
+	m_is_holding_piece = false;
+	m_ai_is_animating = false;
+	m_drawn.clear(); // all redrawn
+	m_drawn_cursor = Cell::EMPTY;
+}
+
+void GBoard::invalidateChanges()
+{
+	/* Cells */
+	auto m_board = m_game->getBoard();
+	const int dim = m_board->getDimension();
+	if ((int) m_drawn.size() != dim * dim) {
+		m_drawn.assign(dim * dim, Cell::EMPTY);
+		m_scheduler->invalidateAll();
+	}
+	for (int i = 0; i < dim; ++i)
+		for (int j = 0; j < dim; ++j)
+			if (m_drawn[i * dim + j] != (*m_board)[i][j]) {
+				m_drawn[i * dim + j] = (*m_board)[i][j];
+				invalidateCell(i, j);
+			}
+	/* Placing cursor, in the color of the player to place */
+	const Cell cursor = m_interactive &&
+		m_game->getStage() == Game::Stage::PLACING_PIECES &&
+		!m_game->isAiTurn() ? m_game->getTurn() : Cell::EMPTY;
+	if (cursor != m_drawn_cursor) {
+		m_drawn_cursor = cursor;
+		invalidatePiece(m_placing_piece_pos);
 	}
-	glEnd();
 }
 
-bool GBoard::setPlayerColor(Cell color) const
+void GBoard::updateAnimation()
 {
-	switch (color) {
-	case Cell::EMPTY:
-		return false;
-	case Cell::YELLOW:
-		glColor3f(1.f, 1.f, 0.f);
-		break;
-	case Cell::RED:
-		glColor3f(1.f, 0.f, 0.f);
-		break;
+	auto now = std::chrono::steady_clock::now();
+	unsigned long long dt =
+		std::chrono::duration_cast<std::chrono::milliseconds>
+		(now - m_ai_animation_start).count();
+	invalidatePiece(m_ai_piece_pos);
+	if (dt >= m_ai_animation_duration) {
+		// The piece lands and the captured pieces go
+		m_ai_is_animating = false;
+		int const* last_move = m_game->getLastMove();
+		invalidateCell(last_move[2], last_move[3]);
+		for (auto const& [rem_i, rem_j] : m_game->getLastRemoved())
+			invalidateCell(rem_i, rem_j);
+		return;
 	}
-	return true;
+	m_ai_progress = (float) dt / (float) m_ai_animation_duration;
+	getAiPiecePosition(m_ai_piece_pos);
+	invalidatePiece(m_ai_piece_pos);
+}
+
+void GBoard::getAiPiecePosition(float* c)
+{
+	int const* last_move = m_game->getLastMove();
+	float last_positions[4];
+	getCellCenter(last_move[0], last_move[1], last_positions);
+	getCellCenter(last_move[2], last_move[3], last_positions + 2);
+	c[0] = last_positions[0] * (1.f - m_ai_progress) + last_positions[2] * m_ai_progress;
+	c[1] = last_positions[1] * (1.f - m_ai_progress) + last_positions[3] * m_ai_progress;
+}
+
+void GBoard::getHeldPiecePosition(float* c)
+{
+	getCellCenter(m_held_piece_indices[0], m_held_piece_indices[1], c);
+	c[0] += m_held_piece_pos_fin[0] - m_held_piece_pos_ini[0];
+	c[1] += m_held_piece_pos_fin[1] - m_held_piece_pos_ini[1];
+}
+
+Rect GBoard::cellRect(int i, int j)
+{
+	const float div = m_l / m_game->getBoard()->getDimension();
+	const float x = m_x + j * div;
+	const float y = m_y + i * div;
+	return Rect{ x, y, x + div, y + div };
+}
+
+Rect GBoard::pieceRect(float cx, float cy)
+{
+	const float r = m_l / m_game->getBoard()->getDimension() * m_disc_fill / 2;
+	return Rect{ cx - r, cy - r, cx + r, cy + r };
+}
+
+void GBoard::invalidateCell(int i, int j)
+{
+	m_scheduler->invalidate(cellRect(i, j));
+}
+
+void GBoard::invalidatePiece(float const* c)
+{
+	m_scheduler->invalidate(pieceRect(c[0], c[1]));
 }
 
 void GBoard::drag_cb(float x, float y)
 {
-	if (m_game->getStage() == Game::Stage::PLAYING &&
+	if (m_interactive &&
+		m_game->getStage() == Game::Stage::PLAYING &&
 		m_is_holding_piece) {
+		float c[2];
+		getHeldPiecePosition(c);
+		invalidatePiece(c);
 		m_held_piece_pos_fin[0] = x;
 		m_held_piece_pos_fin[1] = y;
-		glutPostRedisplay();
+		getHeldPiecePosition(c);
+		invalidatePiece(c);
 	}
 }
 
 void GBoard::move_cb(float x, float y)
 {
 	if (m_game->getStage() == Game::Stage::PLACING_PIECES) {
+		if (m_drawn_cursor != Cell::EMPTY)
+			invalidatePiece(m_placing_piece_pos);
 		m_placing_piece_pos[0] = x;
 		m_placing_piece_pos[1] = y;
-		glutPostRedisplay();
+		if (m_drawn_cursor != Cell::EMPTY)
+			invalidatePiece(m_placing_piece_pos);
 	}
 }
 
@@ -181,7 +246,7 @@ void GBoard::getCellCenter(int i, int j, float* c)
 
 void GBoard::click_cb(int button, int state, float x, float y)
 {
-	if (button == GLUT_LEFT_BUTTON) {
+	if (m_interactive && button == GLUT_LEFT_BUTTON) {
 		auto m_board = m_game->getBoard();
 		const int dim = m_board->getDimension();
 		const float div = m_l / dim;
@@ -207,6 +272,7 @@ void GBoard::click_cb(int button, int state, float x, float y)
 				m_held_piece_pos_ini[0] = m_held_piece_pos_fin[0] = x;
 				m_held_piece_pos_ini[1] = m_held_piece_pos_fin[1] = y;
 				m_is_holding_piece = true;
+				invalidateCell(i, j);
 				break;
 			case Game::Stage::PLACING_PIECES:
 				if (!m_game->placePiece(i, j))
@@ -221,9 +287,9 @@ void GBoard::click_cb(int button, int state, float x, float y)
 			int old_i = m_held_piece_indices[0];
 			int old_j = m_held_piece_indices[1];
 			float c[2];
-			getCellCenter(old_i, old_j, c);
-			c[0] += m_held_piece_pos_fin[0] - m_held_piece_pos_ini[0];
-			c[1] += m_held_piece_pos_fin[1] - m_held_piece_pos_ini[1];
+			getHeldPiecePosition(c);
+			invalidatePiece(c);
+			invalidateCell(old_i, old_j); // back in place if the move fails
 			if (c[0] >= m_x && c[0] <= m_x + m_l &&
 				c[1] >= m_y && c[1] <= m_y + m_l) {
 				int i = (int) ((c[1] - m_y) / div);
@@ -232,6 +298,5 @@ void GBoard::click_cb(int button, int state, float x, float y)
 			}
 			m_is_holding_piece = false;
 		}
-		glutPostRedisplay();
 	}
 }
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "gscrubber.h"
+
+#include <algorithm>
+
+#include <GL/glut.h>
+
+#include "game.h"
+#include "replay.h"
+#include "gboard.h"
+
+GScrubber::GScrubber(std::shared_ptr<Replay> replay,
+	std::shared_ptr<GBoard> board, std::shared_ptr<RedrawScheduler> scheduler) :
+	m_replay(replay),
+	m_board(board),
+	m_scheduler(scheduler),
+	m_is_dragging(false),
+	m_x(0), m_y(0), m_l(100),
+	m_knob(2.f),
+	m_r(0.6f), m_g(0.6f), m_b(0.6f)
+{
+}
+
+void GScrubber::setPosition(float x, float y, float l)
+{
+	m_x = x;
+	m_y = y;
+	m_l = l;
+}
+
+void GScrubber::seek(int ply)
+{
+	ply = std::clamp(ply, 0, m_replay->getPlyCount());
+	if (ply == m_replay->getPly())
+		return;
+	m_board->setGame(std::make_shared<Game>(m_replay->seek(ply)));
+	m_scheduler->invalidate(getArea());
+}
+
+int GScrubber::getPly() const
+{
+	return m_replay->getPly();
+}
+
+int GScrubber::getStep() const
+{
+	return m_replay->getInterval();
+}
+
+void GScrubber::plot()
+{
+	const int plies = m_replay->getPlyCount();
+	/* Bar, with a tick at each snapshot */
+	glColor3f(m_r, m_g, m_b);
+	glBegin(GL_LINES);
+	glVertex2f(m_x, m_y);
+	glVertex2f(m_x + m_l, m_y);
+	for (int p = 0; plies > 0 && p <= plies; p += m_replay->getInterval()) {
+		const float x = m_x + m_l * p / plies;
+		glVertex2f(x, m_y - m_knob / 2);
+		glVertex2f(x, m_y + m_knob / 2);
+	}
+	glEnd();
+	/* Knob */
+	const float x = plies ? m_x + m_l * m_replay->getPly() / plies : m_x;
+	glColor3f(1.f, 1.f, 1.f);
+	glBegin(GL_QUADS);
+	glVertex2f(x - m_knob, m_y - m_knob);
+	glVertex2f(x + m_knob, m_y - m_knob);
+	glVertex2f(x + m_knob, m_y + m_knob);
+	glVertex2f(x - m_knob, m_y + m_knob);
+	glEnd();
+}
+
+void GScrubber::drag_cb(float x, float)
+{
+	if (m_is_dragging)
+		seek(getPlyAt(x));
+}
+
+void GScrubber::move_cb(float, float)
+{
+}
+
+void GScrubber::click_cb(int button, int state, float x, float y)
+{
+	if (button != GLUT_LEFT_BUTTON)
+		return;
+	if (state == GLUT_DOWN) {
+		Rect const area = getArea();
+		if (x < area.x0 || x > area.x1 || y < area.y0 || y > area.y1)
+			return; // Off the bar
+		m_is_dragging = true;
+		seek(getPlyAt(x));
+	} else {
+		m_is_dragging = false;
+	}
+}
+
+Rect GScrubber::getArea() const
+{
+	return Rect{ m_x - m_knob, m_y - m_knob, m_x + m_l + m_knob, m_y + m_knob };
+}
+
+int GScrubber::getPlyAt(float x) const
+{
+	const float t = std::clamp((x - m_x) / m_l, 0.f, 1.f);
+	return (int) (t * m_replay->getPlyCount() + 0.5f);
+}
@@ -0,0 +1,135 @@
+#include "redrawscheduler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <cstring>
+
+#include <GL/glut.h>
+#if __has_include(<GL/glx.h>)
+#include <GL/glx.h>
+#endif
+
+namespace
+{
+	// Frames since the back buffer was last the front one (1 = the last
+	// frame, 2 = the one before), or 0 if unknown: GL leaves it undefined
+	// after a swap, and only GLX_EXT_buffer_age tells what it holds
+	int getBackBufferAge()
+	{
+#if defined(GLX_BACK_BUFFER_AGE_EXT)
+		Display* display = glXGetCurrentDisplay();
+		GLXDrawable drawable = glXGetCurrentDrawable();
+		if (!display || !drawable)
+			return 0;
+		static const bool supported = [display]() {
+			char const* extensions = glXQueryExtensionsString(display,
+				DefaultScreen(display));
+			return extensions && std::strstr(extensions, "GLX_EXT_buffer_age");
+		}();
+		if (!supported)
+			return 0;
+		unsigned int age = 0;
+		glXQueryDrawable(display, drawable, GLX_BACK_BUFFER_AGE_EXT, &age);
+		return (int) age;
+#else
+		return 0;
+#endif
+	}
+}
+
+RedrawScheduler::RedrawScheduler(float left, float right, float bottom,
+	float top, int width, int height, unsigned int frame_ms) :
+	m_left(left), m_right(right), m_bottom(bottom), m_top(top),
+	m_width(width), m_height(height),
+	m_frame_ms(frame_ms),
+	m_posted(false),
+	m_dirty(false), m_dirty_all(true),
+	m_dirty_rect{ 0, 0, 0, 0 },
+	m_last(false), m_last_all(true),
+	m_last_rect{ 0, 0, 0, 0 },
+	m_frame_all(true),
+	m_frame_rect{ 0, 0, 0, 0 }
+{
+}
+
+void RedrawScheduler::resize(int width, int height)
+{
+	m_width = width;
+	m_height = height;
+	invalidateAll();
+}
+
+void RedrawScheduler::invalidate(Rect const& rect)
+{
+	if (m_dirty)
+		join(m_dirty_rect, rect);
+	else
+		m_dirty_rect = rect;
+	m_dirty = true;
+}
+
+void RedrawScheduler::invalidateAll()
+{
+	m_dirty_all = true;
+}
+
+void RedrawScheduler::tick()
+{
+	if (!isDirty() || m_posted)
+		return;
+	m_posted = true;
+	glutPostRedisplay();
+}
+
+void RedrawScheduler::beginFrame()
+{
+	// Not posted by us, or a back buffer of unknown contents: the whole
+	// window may be stale
+	const int age = getBackBufferAge();
+	m_frame_all = !m_posted || m_dirty_all || (age != 1 && age != 2) ||
+		(age == 2 && m_last_all);
+	m_frame_rect = m_dirty_rect;
+	if (!m_frame_all && age == 2 && m_last) // Posted frames always have m_dirty set
+		join(m_frame_rect, m_last_rect);
+	m_last = m_dirty;
+	m_last_all = m_frame_all && (!m_posted || m_dirty_all);
+	m_last_rect = m_dirty_rect;
+	m_dirty = m_dirty_all = false;
+	if (m_frame_all)
+		return;
+
+	// World to window pixels, which count up from the bottom left corner,
+	// rounded outwards with a pixel to spare for antialiased edges
+	const float sx = m_width / (m_right - m_left);
+	const float sy = m_height / (m_top - m_bottom);
+	const float xa = (m_frame_rect.x0 - m_left) * sx;
+	const float xb = (m_frame_rect.x1 - m_left) * sx;
+	const float ya = (m_frame_rect.y0 - m_bottom) * sy;
+	const float yb = (m_frame_rect.y1 - m_bottom) * sy;
+	const int px0 = std::max(0, (int) std::floor(std::min(xa, xb)) - 1);
+	const int py0 = std::max(0, (int) std::floor(std::min(ya, yb)) - 1);
+	const int px1 = std::min(m_width, (int) std::ceil(std::max(xa, xb)) + 1);
+	const int py1 = std::min(m_height, (int) std::ceil(std::max(ya, yb)) + 1);
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(px0, py0, std::max(0, px1 - px0), std::max(0, py1 - py0));
+}
+
+void RedrawScheduler::endFrame()
+{
+	glDisable(GL_SCISSOR_TEST);
+	m_posted = false;
+}
+
+bool RedrawScheduler::isRedrawn(Rect const& rect) const
+{
+	return m_frame_all || m_frame_rect.intersects(rect);
+}
+
+void RedrawScheduler::join(Rect& rect, Rect const& other)
+{
+	rect.x0 = std::min(rect.x0, other.x0);
+	rect.y0 = std::min(rect.y0, other.y0);
+	rect.x1 = std::max(rect.x1, other.x1);
+	rect.y1 = std::max(rect.y1, other.y1);
+}